@@ -24,10 +24,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /*
 This class defines the Cooley-Tukey algorithm for the Fourier Transform computation.
 The data (time domain or spectrum) has to be stored in the real and imag vectors. Then
-the direct FFT transform can be computed with a call to reverse(), and the reverse FFT
+the direct FFT transform can be computed with a call to direct(), and the reverse FFT
 transform can be computed with a call to reverse(). The result is computed on-site, i.e.
-in the vectors given to the FFT object. FFT computes the Fourier transform in O(nlog(n))
-instead of O(n^2).
+in the vectors given to the FFT object, without allocating anything. The bit-reversal
+order and the twiddle factors come from a plan shared by all the FFTs of the same size.
+FFT computes the Fourier transform in O(nlog(n)) instead of O(n^2).
 */
 
 #ifndef FFTHPP
@@ -36,27 +37,27 @@ instead of O(n^2).
 #include <iostream>
 #include <vector>
 
+#include "FFTPlan.hpp"
+
 class FFT {
 
     public:
     
-        FFT(const int, std::vector<double>* const, std::vector<double>* const);
+        FFT(const FFTPlan* const, std::vector<double>* const, std::vector<double>* const);
     
-        void direct()  { sort(); radix_direct(); }
-        void reverse() { sort(); radix_reverse(); }
+        void direct()  { transform(-1); }
+        void reverse() { transform(1); }
     
     private:
     
         typedef std::vector<double>* vec_d_p;
     
-        void radix_direct();
-        void radix_reverse();
-        void sort();
-
-        const int n;      /* power of two, the size of the vector */
-        const int p;      /* so that n = 2^p */
-        vec_d_p   real;   /* data vector, real values */
-        vec_d_p   imag;   /* data vectorn imaginary values */
+        void transform(const double);
+
+        const FFTPlan* const plan;   /* tables of the size of the vectors */
+        const int            n;      /* power of two, the size of the vector */
+        vec_d_p              real;   /* data vector, real values */
+        vec_d_p              imag;   /* data vector, imaginary values */
     
 };
 
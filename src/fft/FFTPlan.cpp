@@ -0,0 +1,54 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "FFTPlan.hpp"
+
+/*
+Computes the bit-reversal permutation and the twiddle factors for the size n.
+*/
+FFTPlan::FFTPlan(const int p_n) :
+    n(p_n),
+    reversed(p_n),
+    cos_table(p_n/2),
+    sin_table(p_n/2) {
+    int bits = 0;
+    while((1<<bits)<n) bits++;
+    for(int i=0 ; i<n ; i++) {
+        int r = 0;
+        for(int b=0 ; b<bits ; b++) if(i & (1<<b)) r |= 1<<(bits-1-b);
+        reversed[i] = r;
+    }
+    for(int k=0 ; k<n/2 ; k++) {
+        cos_table[k] = cos((2*M_PI*k)/n);
+        sin_table[k] = sin((2*M_PI*k)/n);
+    }
+}
+
+/*
+Returns the nb of bytes held by the plan.
+*/
+const std::size_t FFTPlan::get_size() const {
+    return sizeof(FFTPlan) + sizeof(int)*reversed.capacity() + sizeof(double)*(cos_table.capacity() + sin_table.capacity());
+}
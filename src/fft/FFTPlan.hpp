@@ -0,0 +1,57 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class holds what the FFTs of one size have in common: the order in which the
+values are read, given by the bit-reversal of their indices, and the twiddle factors
+exp(2.i.pi.k/n). A plan is never changed once built, so any number of FFT objects,
+from any number of oceans and threads, can share the plan of their size.
+*/
+
+#ifndef FFTPLANHPP
+#define FFTPLANHPP
+
+#include <vector>
+
+class FFTPlan {
+
+    public:
+
+        FFTPlan(const int);
+
+        const int     get_n()        const { return n; }
+        const int*    get_reversed() const { return reversed.data(); }
+        const double* get_cos()      const { return cos_table.data(); }
+        const double* get_sin()      const { return sin_table.data(); }
+        const std::size_t get_size() const;
+
+    private:
+
+        const int           n;           /* power of two, the size of the transforms */
+        std::vector<int>    reversed;    /* index of the value read at each position, bits reversed */
+        std::vector<double> cos_table;   /* cos(2.pi.k/n) for k in [0 ; n/2[ */
+        std::vector<double> sin_table;   /* sin(2.pi.k/n) for k in [0 ; n/2[ */
+
+};
+
+#endif
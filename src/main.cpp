@@ -21,29 +21,46 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "parameters/Parameters.hpp"
 
-#include "ocean/Ocean.hpp"
-#include "ocean/Height.hpp"
-#include "ocean/Philipps.hpp"
+#include "ocean/Buoyancy.hpp"
+#include "ocean/Cascade.hpp"
+#include "ocean/Controller.hpp"
+#include "ocean/Host.hpp"
+#include "ocean/Philox.hpp"
+#include "ocean/Publisher.hpp"
+#include "ocean/Pyramid.hpp"
+#include "ocean/Recorder.hpp"
+#include "ocean/SparseOcean.hpp"
+#include "ocean/StateCache.hpp"
+#include "ocean/Tiling.hpp"
 
 #include "rendering/Window.hpp"
 
-Ocean* ocean;
-int    mainwindow;
-
-void       build_menu(Parameters* const);
-const bool check_errors(Parameters* const);
+void                  build_menu(Parameters* const);
+const Spectrum::MODEL spectrum_model(const std::string&);
+const bool            check_errors(Parameters* const);
+const uint64_t        state_key(Parameters* const, const uint32_t);
+const uint64_t        loop_key(Parameters* const, const uint32_t);
+const bool            save_state(StateCache* const, const double);
+void                  run_headless(Host* const, const std::vector<Cascade*>&, const int, const double, const double, LoopCache* const, Recorder* const, Publisher* const);
+void                  run_probes(Cascade* const, const int, const double, const double, const int, const std::string&, const Tiling* const);
+void                  run_rays(Cascade* const, const int, const double, const double, const double, const std::string&, const Tiling* const);
+void                  run_bodies(Host* const, Cascade* const, const int, const double, const double, const int, const uint32_t, const Tiling* const);
+void                  print_memory(Host* const, const std::vector<Cascade*>&, LoopCache* const, const int, const bool);
 
 int main(int argc, char** argv) {
 
-    /* random for gaussian numbers */
-    srand(time(NULL));
-    
     /* args parser */
     Parameters::config p_c {40, 90, 3, 1, 17, 5, 3, 2, Parameters::lang_us};
     Parameters p(argc, argv, p_c);
@@ -74,30 +91,188 @@ int main(int argc, char** argv) {
     }
     
     /* ocean parameters */
-    const double lx             = p.num_val<double>("lx");
-    const double ly             = p.num_val<double>("ly");
-    const int    nx             = p.num_val<int>("nx");
-    const int    ny             = p.num_val<int>("ny");
-    const double wind_speed     = p.num_val<double>("wind_speed");
-    const int    wind_alignment = p.num_val<int>("wind_alignment");
-    const double min_wave_size  = p.num_val<double>("min_wave_size");
-    const double A              = p.num_val<double>("A");
-    const double motion_factor  = p.num_val<double>("motion_factor");
-    
-    Philipps philipps(lx, ly, nx, ny, wind_speed, wind_alignment, min_wave_size, A);
-    Height   height(nx, ny);
-    ocean = new Ocean(lx, ly, nx, ny, motion_factor);
-    
-    height.generate_philipps(&philipps); /* Philipps spectrum */
-    ocean->generate_height(&height);     /* initial ocean wave height field */
-    
-    /* rendering */
-    Window::init(WIDTH, HEIGHT, "FFTOcean", argc, argv, p.cho_val("keyboard"), p.num_val<int>("fps"), p.num_val<float>("camera_speed"));
-    Window::launch();
+    const double   lx             = p.num_val<double>("lx");
+    const double   ly             = p.num_val<double>("ly");
+    const int      nx             = p.num_val<int>("nx");
+    const int      ny             = p.num_val<int>("ny");
+    const double   wind_speed     = p.num_val<double>("wind_speed");
+    const int      wind_alignment = p.num_val<int>("wind_alignment");
+    const double   min_wave_size  = p.num_val<double>("min_wave_size");
+    const double   A              = p.num_val<double>("A");
+    const double   fetch          = p.num_val<double>("fetch");
+    const double   depth          = p.num_val<double>("depth");
+    const uint32_t seed           = p.is_spec("seed") ? p.num_val<uint32_t>("seed") : static_cast<uint32_t>(time(NULL));
+    const double   motion_factor  = p.num_val<double>("motion_factor");
+    const double   choppiness     = p.num_val<double>("choppiness");
+    const double   foam_threshold = p.num_val<double>("foam_threshold");
+    const double   foam_decay     = p.num_val<double>("foam_decay");
+    const int      cascades       = p.num_val<int>("cascades");
+    const double   cascade_ratio  = p.num_val<double>("cascade_ratio");
+    const double   mode_cutoff    = p.num_val<double>("mode_cutoff");
+    const bool     hermite        = p.cho_val("interpolation")=="hermite" && (!p.is_spec("headless") || p.is_spec("loop"));
+    
+    /* threads and FFT plans, shared by all the oceans */
+    Host host(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    
+    Cascade* ocean = new Cascade(&host, lx, ly, nx, ny, cascades, cascade_ratio, motion_factor, choppiness, foam_threshold, foam_decay, hermite, mode_cutoff, depth);
+    ocean->set_spectrum(spectrum_model(p.cho_val("spectrum")), wind_speed, wind_alignment, min_wave_size, A, fetch, seed);
+    
+    /* initial ocean wave height fields, restored from the state file if it matches */
+    StateCache* state      = p.is_spec("state") ? new StateCache(ocean, p.str_val("state"), state_key(&p, seed)) : nullptr;
+    double      start_time = 0;
+    if(state && state->load(&start_time)) {
+        std::cout << "Resumed from " << p.str_val("state") << " at t = " << start_time << " s." << std::endl;
+    }
+    else {
+        ocean->generate_height();
+        std::cout << "Seed: " << seed << std::endl;
+        if(state && !save_state(state, start_time)) {
+            delete state;
+            delete ocean;
+            return 0;
+        }
+    }
+    ocean->print_modes(std::cout);
+    
+    /* other oceans computed with this one, with the next seeds */
+    std::vector<Cascade*> oceans(1, ocean);
+    for(int i=1 ; i<p.num_val<int>("instances") ; i++) {
+        oceans.push_back(new Cascade(&host, lx, ly, nx, ny, cascades, cascade_ratio, motion_factor, choppiness, foam_threshold, foam_decay, hermite, mode_cutoff, depth));
+        oceans[i]->set_spectrum(spectrum_model(p.cho_val("spectrum")), wind_speed, wind_alignment, min_wave_size, A, fetch, seed+i);
+        oceans[i]->generate_height();
+    }
+    
+    /* seamless loop, precomputed once */
+    LoopCache* cache = nullptr;
+    if(p.is_spec("loop")) {
+        typedef std::chrono::steady_clock clock;
+        const double            period = p.num_val<double>("loop");
+        const clock::time_point start  = clock::now();
+        ocean->quantize_dispersion(period);
+        cache = new LoopCache(ocean, period, std::max(2, static_cast<int>(period*p.num_val<int>("sim_rate") + 0.5)), loop_key(&p, seed));
+        try {
+            cache->build(p.is_spec("loop_cache") ? p.str_val("loop_cache") : "");
+        }
+        catch(const std::exception& e) {
+            std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+            delete cache;
+            delete state;
+            delete ocean;
+            return 0;
+        }
+        std::cout << (cache->is_reused() ? "Loaded " : "Precomputed ") << cache->get_rate()*period << " frames (" << cache->get_size()/1048576.0 << " MB) in "
+                  << std::chrono::duration<double>(clock::now() - start).count() << " s." << std::endl;
+    }
+    
+    /* recording of the frames */
+    Recorder* recorder = nullptr;
+    if(p.is_spec("record")) {
+        const double max_error = p.is_spec("record_error") ? p.num_val<double>("record_error") : 0;
+        recorder = new Recorder(ocean, host.get_pool(), p.is_spec("record_normals"), max_error, p.cho_val("record_coding")=="zstd" ? Codec::ZSTD : Codec::RICE);
+        try {
+            recorder->open(p.str_val("record"));
+        }
+        catch(const std::exception& e) {
+            std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+            delete recorder;
+            delete cache;
+            delete state;
+            delete ocean;
+            return 0;
+        }
+    }
+    
+    /* live frames for other processes */
+    Publisher* publisher = nullptr;
+    if(p.is_spec("publish")) {
+        publisher = new Publisher(ocean, p.is_spec("publish_normals"));
+        try {
+            publisher->open(p.str_val("publish"));
+        }
+        catch(const std::exception& e) {
+            std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+            delete publisher;
+            delete recorder;
+            delete cache;
+            delete state;
+            delete ocean;
+            return 0;
+        }
+    }
+    
+    /* live changes of the waves, from the keys of the window or a control file */
+    Controller* controller = nullptr;
+    if(!cache && (p.is_spec("control") || !p.is_spec("headless"))) {
+        controller = new Controller(ocean, wind_speed, wind_alignment, min_wave_size, A, p.num_val<double>("fade"));
+        try {
+            if(p.is_spec("control")) controller->open(p.str_val("control"));
+        }
+        catch(const std::exception& e) {
+            std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+            delete controller;
+            delete publisher;
+            delete recorder;
+            delete cache;
+            delete state;
+            delete ocean;
+            return 0;
+        }
+    }
+    
+    /* memory held by each component */
+    if(p.is_spec("mem_report")) {
+        const int nb_frames = !p.is_spec("headless") ? 6 : (recorder || publisher ? 1 : 0);
+        print_memory(&host, oceans, cache, nb_frames, hermite);
+    }
+    
+    /* offline simulation, or rendering */
+    if(p.is_spec("headless") && (p.is_spec("probes") || p.is_spec("rays") || p.is_spec("bodies"))) {
+        const Tiling* const tiling = p.is_spec("horizon") ? new Tiling(ocean, seed) : nullptr;
+        if(p.is_spec("probes")) {
+            run_probes(ocean, p.num_val<int>("frames"), p.num_val<double>("dt"), start_time, p.num_val<int>("sparse"), p.str_val("probes"), tiling);
+        }
+        else if(p.is_spec("rays")) {
+            run_rays(ocean, p.num_val<int>("frames"), p.num_val<double>("dt"), start_time, p.num_val<double>("ray_range"), p.str_val("rays"), tiling);
+        }
+        else {
+            run_bodies(&host, ocean, p.num_val<int>("frames"), p.num_val<double>("dt"), start_time, p.num_val<int>("bodies"), seed, tiling);
+        }
+        delete tiling;
+    }
+    else if(p.is_spec("headless")) {
+        run_headless(&host, oceans, p.num_val<int>("frames"), p.num_val<double>("dt"), start_time, cache, recorder, publisher);
+    }
+    else {
+        const double size    = std::max(lx, ly);
+        Horizon*     horizon = p.is_spec("horizon") ? new Horizon(ocean, host.get_pool(), p.num_val<int>("horizon"), size*p.num_val<double>("horizon_blend", 1), size*p.num_val<double>("horizon_blend", 2), motion_factor, seed) : nullptr;
+        Simulation   simulation(ocean, p.num_val<int>("sim_rate"), cache, start_time, publisher);
+        Window::init(WIDTH, HEIGHT, "FFTOcean", argc, argv, p.cho_val("keyboard"), p.num_val<int>("fps"), p.num_val<float>("camera_speed"));
+        Window::launch(&simulation, controller, horizon);
+        Window::quit();
+        delete horizon;
+    }
+    
+    /* end of the recording */
+    if(recorder) {
+        try {
+            recorder->close();
+            std::cout << "Recorded " << recorder->get_nb_frames() << " frames (" << recorder->get_size()/1048576.0 << " MB) to " << p.str_val("record") << "." << std::endl;
+        }
+        catch(const std::exception& e) {
+            std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+        }
+    }
+    
+    /* checkpoint, for the next run to resume with the next frame */
+    if(state && p.is_spec("headless")) save_state(state, start_time + p.num_val<int>("frames")*p.num_val<double>("dt"));
     
     /* free */
-    Window::quit();
-    delete ocean;
+    delete controller;
+    delete publisher;
+    delete recorder;
+    delete cache;
+    delete state;
+    for(std::size_t i=0 ; i<oceans.size() ; i++) delete oceans[i];
     
     return 0;
     
@@ -112,6 +287,24 @@ void build_menu(Parameters* const p) {
     p->define_param                   ("help", "Displays this help.");
     p->define_param                   ("license", "Displays the GPL license.");
     p->define_param                   ("run", "Runs the simulation");
+    p->define_param                   ("headless", "Runs the simulation without any window, as fast as possible, and prints the timings.");
+    p->define_num_str_param<int>      ("frames", {"value"}, {1000}, "Number of frames to simulate in headless mode.", true);
+    p->define_num_str_param<double>   ("dt", {"value"}, {0.04}, "Simulated time between two frames in headless mode, in seconds.", true);
+    p->define_num_str_param<std::string>("probes", {"file"}, {""}, "In headless mode, prints the height of the ocean at the points of this file for every frame, instead of the timings. Each line of the file holds the actual x and z coordinates of one point.");
+    p->define_num_str_param<std::string>("rays", {"file"}, {""}, "In headless mode, prints the distance from the origin of each ray of this file to the surface for every frame, or -1 if the ray misses it, instead of the timings. Each line of the file holds the actual x, y and z coordinates of the origin of one ray, then of its direction.");
+    p->define_num_str_param<double>   ("ray_range", {"value"}, {10000}, "Maximum distance of the rays.", true);
+    p->define_num_str_param<int>      ("bodies", {"value"}, {10000}, "In headless mode, drops this number of boxes at random on the ocean, and prints their mean height and submerged fraction for every frame, instead of the timings.");
+    p->define_num_str_param<std::string>("record", {"file"}, {""}, "In headless mode, records every frame to this binary file: the heights, and the horizontal displacements if the waves are choppy. The file has an index, so that any frame can be read directly.");
+    p->define_param                   ("record_normals", "Records the normals of the surface too.");
+    p->define_num_str_param<double>   ("record_error", {"value"}, {0.001}, "Compresses the recorded frames, with at most this absolute error on every value. Each frame is quantized to 16 bits and coded as its difference with the previous one.");
+    p->define_choice_param            ("record_coding", "mode", "rice", {{"rice", "Adaptive Rice codes, fast."},
+                                                                         {"zstd", "zstd, if the program is built with it (make linux ZSTD=1)."}},
+                                       "Coding of the compressed frames.");
+    p->define_num_str_param<std::string>("publish", {"name"}, {""}, "Publishes every frame in a POSIX shared memory of this name, starting with a '/', for other processes to read the live surface (see fftocean_reader).");
+    p->define_param                   ("publish_normals", "Publishes the normals of the surface too.");
+    p->define_num_str_param<int>      ("sparse", {"value"}, {256}, "Number of waves summed directly at the probes, when there are too few probes for the FFT to be worth it.", true);
+    p->define_num_str_param<int>      ("instances", {"value"}, {1}, "In headless mode, simulates this number of oceans at once, with the seeds following the given one. They share the threads and the FFT tables of the process.", true);
+    p->define_param                   ("mem_report", "Prints the memory held by each component of the ocean, the frames and the loop cache before running.");
                                        
     p->insert_subsection("ENVIRONMENT DIMENSIONS AND FACTORS");
     p->define_num_str_param<double>   ("lx", {"value"}, {350}, "Actual width of the ocean.", true);
@@ -121,17 +314,52 @@ void build_menu(Parameters* const p) {
     p->define_num_str_param<double>   ("wind_speed", {"value"}, {50}, "Speed of the wind.", true);
     p->define_num_str_param<int>      ("wind_alignment", {"value"}, {2}, "Defines how the waves should stay in the wind's direction. This parameter is an integer.", true);
     p->define_num_str_param<double>   ("min_wave_size", {"value"}, {0.1}, "Defines the minimum wave height and makes the simulation smoother.", true);
-    p->define_num_str_param<double>   ("A", {"value"}, {0.0000038}, "Adjustment parameter, to increase or decrease wave depth.", true);
+    p->define_choice_param            ("spectrum", "model", "philipps", {{"philipps", "Spectrum of J. Tessendorf's paper, scaled by A."},
+                                                                          {"pierson_moskowitz", "Sea fully developed by a constant wind."},
+                                                                          {"jonswap", "Sea still growing over a limited fetch, with a sharper peak."},
+                                                                          {"tma", "JONSWAP spectrum damped in shallow water of the given depth."}},
+                                       "Spectrum of the waves. All but the Philipps spectrum give the actual wave heights, in meters.");
+    p->define_num_str_param<uint32_t> ("seed", {"value"}, {0}, "Seed of the random waves. The same seed always gives the same ocean, on any machine. By default, the seed depends on the time, and is printed.");
+    p->define_num_str_param<double>   ("A", {"value"}, {0.0000019}, "Adjustment parameter, to increase or decrease wave depth.", true);
+    p->define_num_str_param<double>   ("fetch", {"value"}, {100000}, "Distance over which the wind blows, in meters, for the JONSWAP and TMA spectra.", true);
+    p->define_num_str_param<double>   ("depth", {"value"}, {100}, "Depth of the sea, in meters. The waves longer than about twice the depth are slowed down, and the TMA spectrum damps them.", true);
+    p->define_num_str_param<double>   ("choppiness", {"value"}, {0}, "Horizontal displacement of the waves, which sharpens the crests. The foam is only computed if this is not zero.", true);
+    p->define_num_str_param<double>   ("foam_threshold", {"value"}, {0.3}, "Foam appears where the jacobian of the displacement goes below this value.", true);
+    p->define_num_str_param<double>   ("foam_decay", {"value"}, {2}, "Time constant of the foam fading, in seconds.", true);
+    p->define_num_str_param<int>      ("cascades", {"value"}, {1}, "Number of oceans of decreasing sizes summed together, from 1 to 4. Each of them computes a band of the spectrum, which hides the periodicity of the ocean.", true);
+    p->define_num_str_param<double>   ("cascade_ratio", {"value"}, {4}, "Size ratio between two consecutive cascades. It must be greater than 1 and at most a quarter of the number of subdivisions.", true);
+    p->define_num_str_param<double>   ("mode_cutoff", {"value"}, {0.000001}, "Waves with less energy than this fraction of the strongest wave are not computed. Zero keeps all of them.", true);
     
     p->insert_subsection("CAMERA SETTINGS");
     p->define_num_str_param<int>      ("fps", {"value"}, {35}, "Target FPS.", true);
     p->define_num_str_param<double>   ("motion_factor", {"value"}, {0.6}, "Allows to slow down or speed up the simulation.", true);
+    p->define_num_str_param<int>      ("sim_rate", {"value"}, {15}, "Number of ocean frames computed per second. The rendering interpolates between them at the display rate.", true);
+    p->define_choice_param            ("interpolation", "mode", "hermite", {{"linear", "Straight line between two frames."},
+                                                                            {"hermite", "Cubic interpolation using the time derivative of the heights, which costs one more FFT for choppy waves."}},
+                                       "Interpolation of the heights between two frames.");
+    p->define_num_str_param<double>   ("loop", {"period"}, {10}, "Makes the ocean periodic in time with the given period, in seconds, and precomputes all the frames of one period. No FFT is computed afterwards.");
+    p->define_num_str_param<std::string>("state", {"file"}, {""}, "Restores the ocean from this file if it was saved with the same parameters and seed, instead of generating it again. Otherwise, the new ocean is saved to it. In headless mode, the state at the end of the run is saved too, so that the next run resumes the simulation where it stopped.");
+    p->define_num_str_param<std::string>("control", {"file"}, {""}, "Reads commands changing the waves from this file, usually a named pipe, which is created if it does not exist. Each line holds a name and a value: wind_speed, wind_alignment, min_wave_size, A, or fade. In the window, the keys U/J, I/K, O/L and P/M change the wind speed, the wind alignment, A and the minimum wave size too.");
+    p->define_num_str_param<double>   ("fade", {"value"}, {2}, "Duration of the transition to the new waves after a change, in seconds.", true);
+    p->define_num_str_param<std::string>("loop_cache", {"file"}, {""}, "Keeps the frames of the loop in this memory-mapped file instead of memory. The file is reused by the next runs with the same dimensions.");
     p->define_num_str_param<float>    ("camera_speed", {"value"}, {0.2}, "Translation speed of the camera.", true);
+    p->define_num_str_param<int>      ("horizon", {"tiles"}, {8}, "Draws an infinite ocean: the ocean is repeated up to this number of tiles around the camera, and waves of gradient noise take over from it in the distance, which hides the repetition. In headless mode, the probes, rays and bodies see the same tiles, without the noise.");
+    p->define_num_str_param<double>   ("horizon_blend", {"start", "end"}, {1, 3}, "Distances to the camera, in sizes of the ocean, between which the noise takes over from the ocean.", true);
     p->define_choice_param            ("keyboard", "mode", "azerty", {{"azerty", "Z, Q, S, D: forward, left, backward, right."},
                                                                       {"qwerty", "W, A, S, D: forward, left, backward, right."}},
                                        "Specifies the type of keyboard.");
 }
 
+/*
+Returns the spectrum model of the given name.
+*/
+const Spectrum::MODEL spectrum_model(const std::string& name) {
+    if(name=="pierson_moskowitz") return Spectrum::PIERSON_MOSKOWITZ;
+    else if(name=="jonswap")      return Spectrum::JONSWAP;
+    else if(name=="tma")          return Spectrum::TMA;
+    else                          return Spectrum::PHILIPPS;
+}
+
 const bool check_errors(Parameters* const p) {
     if(p->num_val<double>("lx")<=0)
         std::cerr << "Ocean width must be positive." << std::endl;
@@ -147,12 +375,80 @@ const bool check_errors(Parameters* const p) {
         std::cerr << "Minimum wave size cannot be negative." << std::endl;
     else if(p->num_val<double>("A")<0)
         std::cerr << "A cannot be zero." << std::endl;
+    else if(p->cho_val("spectrum")!="philipps" && p->num_val<double>("wind_speed")<=0)
+        std::cerr << "Wind speed must be positive with this spectrum." << std::endl;
+    else if(p->num_val<double>("fetch")<=0)
+        std::cerr << "Fetch must be positive." << std::endl;
+    else if(p->num_val<double>("depth")<=0)
+        std::cerr << "Depth must be positive." << std::endl;
+    else if(p->num_val<double>("choppiness")<0)
+        std::cerr << "Choppiness cannot be negative." << std::endl;
+    else if(p->num_val<double>("foam_decay")<0)
+        std::cerr << "Foam decay cannot be negative." << std::endl;
+    else if(p->num_val<int>("cascades")<1 || p->num_val<int>("cascades")>4)
+        std::cerr << "Number of cascades must be between 1 and 4." << std::endl;
+    else if(p->num_val<int>("cascades")>1 && (p->num_val<double>("cascade_ratio")<=1 || 4*p->num_val<double>("cascade_ratio")>std::min(p->num_val<int>("nx"), p->num_val<int>("ny"))))
+        std::cerr << "Cascade ratio must be greater than 1 and at most a quarter of the number of subdivisions." << std::endl;
+    else if(p->num_val<double>("mode_cutoff")<0 || p->num_val<double>("mode_cutoff")>=1)
+        std::cerr << "Mode cutoff must be in [0 ; 1[." << std::endl;
     else if(p->num_val<int>("fps")<=0)
         std::cerr << "FPS must be positive." << std::endl;
     else if(p->num_val<double>("motion_factor")<=0)
         std::cerr << "Motion factor must be positive." << std::endl;
     else if(p->num_val<float>("camera_speed")<=0)
         std::cerr << "Camera speed must be positive." << std::endl;
+    else if(p->num_val<int>("sim_rate")<=0)
+        std::cerr << "Simulation rate must be positive." << std::endl;
+    else if(p->is_spec("loop") && p->num_val<double>("loop")<=0)
+        std::cerr << "Loop period must be positive." << std::endl;
+    else if(p->num_val<int>("frames")<=0)
+        std::cerr << "Number of frames must be positive." << std::endl;
+    else if(p->num_val<double>("dt")<=0)
+        std::cerr << "Time step must be positive." << std::endl;
+    else if(p->is_spec("state") && !p->is_spec("seed"))
+        std::cerr << "The state file needs a seed." << std::endl;
+    else if(p->num_val<int>("sparse")<=0)
+        std::cerr << "Number of sparse waves must be positive." << std::endl;
+    else if(p->is_spec("probes") && !p->is_spec("headless"))
+        std::cerr << "Probes are only available in headless mode." << std::endl;
+    else if(p->is_spec("probes") && p->is_spec("loop"))
+        std::cerr << "Probes cannot be used with a loop." << std::endl;
+    else if(p->is_spec("rays") && (!p->is_spec("headless") || p->is_spec("probes") || p->is_spec("loop")))
+        std::cerr << "Rays are only available in headless mode, without probes or loop." << std::endl;
+    else if(p->num_val<double>("ray_range")<=0)
+        std::cerr << "Ray range must be positive." << std::endl;
+    else if(p->is_spec("bodies") && (!p->is_spec("headless") || p->is_spec("probes") || p->is_spec("rays") || p->is_spec("loop")))
+        std::cerr << "Bodies are only available in headless mode, without probes, rays or loop." << std::endl;
+    else if(p->num_val<int>("bodies")<=0)
+        std::cerr << "Number of bodies must be positive." << std::endl;
+    else if(p->is_spec("record") && (!p->is_spec("headless") || p->is_spec("probes") || p->is_spec("rays") || p->is_spec("bodies")))
+        std::cerr << "Recording is only available in headless mode, without probes, rays or bodies." << std::endl;
+    else if((p->is_spec("record_normals") || p->is_spec("record_error")) && !p->is_spec("record"))
+        std::cerr << "The normals and the error can only be given with a recording file." << std::endl;
+    else if(p->is_spec("publish") && (p->str_val("publish").size()<2 || p->str_val("publish")[0]!='/' || p->str_val("publish").find('/', 1)!=std::string::npos))
+        std::cerr << "The name of the shared memory must start with a '/' and have no other one." << std::endl;
+    else if(p->is_spec("publish_normals") && !p->is_spec("publish"))
+        std::cerr << "The normals can only be published with a shared memory." << std::endl;
+    else if(p->is_spec("publish") && (p->is_spec("probes") || p->is_spec("rays") || p->is_spec("bodies")))
+        std::cerr << "Frames cannot be published with probes, rays or bodies." << std::endl;
+    else if(p->is_spec("control") && (p->is_spec("loop") || p->is_spec("state") || p->is_spec("probes") || p->is_spec("rays") || p->is_spec("bodies")))
+        std::cerr << "The waves cannot be changed with a loop, a state file, probes, rays or bodies." << std::endl;
+    else if(p->num_val<int>("instances")<1)
+        std::cerr << "Number of instances must be positive." << std::endl;
+    else if(p->num_val<int>("instances")>1 && (!p->is_spec("headless") || p->is_spec("probes") || p->is_spec("rays") || p->is_spec("bodies") || p->is_spec("record") || p->is_spec("publish") || p->is_spec("state") || p->is_spec("loop") || p->is_spec("control")))
+        std::cerr << "Several instances are only available in headless mode, without probes, rays, bodies, recording, publishing, state file, loop or control file." << std::endl;
+    else if(p->is_spec("horizon") && p->is_spec("headless") && !p->is_spec("probes") && !p->is_spec("rays") && !p->is_spec("bodies"))
+        std::cerr << "In headless mode, the horizon only tiles the ocean under probes, rays or bodies." << std::endl;
+    else if(p->is_spec("horizon") && p->num_val<int>("horizon")<1)
+        std::cerr << "The horizon needs at least one tile around the camera." << std::endl;
+    else if(p->num_val<double>("horizon_blend", 1)<0 || p->num_val<double>("horizon_blend", 2)<=p->num_val<double>("horizon_blend", 1))
+        std::cerr << "The start of the noise cannot be negative, and must come before its end." << std::endl;
+    else if(p->num_val<double>("fade")<0)
+        std::cerr << "Fade time cannot be negative." << std::endl;
+    else if(p->is_spec("record_error") && p->num_val<double>("record_error")<=0)
+        std::cerr << "Recording error must be positive." << std::endl;
+    else if(p->cho_val("record_coding")=="zstd" && !Codec::has_zstd())
+        std::cerr << "This program is built without zstd." << std::endl;
     else
         return true;
     return false;
@@ -182,3 +478,246 @@ const bool check_errors(Parameters* const p) {
 
 
 
+
+/*
+Simulates the given number of frames with a fixed time step from the start
+time, without opening any window. The ocean is stepped as fast as possible,
+and the frame rate and the time spent in each stage are printed at the end.
+With a loop cache, the frames are read from the cache instead. With a recorder,
+every frame of the first ocean is also given to the recorder, which writes it in
+the background, and with a publisher, it is published for the other processes.
+All the oceans are computed together by the threads of the host.
+*/
+void run_headless(Host* const host, const std::vector<Cascade*>& oceans, const int frames, const double dt, const double start_time, LoopCache* const cache, Recorder* const recorder, Publisher* const publisher) {
+    Cascade* const          ocean = oceans[0];
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point start = clock::now();
+    Heightfield             frame;
+    for(int i=0 ; i<frames ; i++) {
+        const double t = start_time + i*dt;
+        if(cache) {
+            cache->fill_heightfield(t, &frame);
+        }
+        else {
+            host->main_computation(oceans, t);
+            if(recorder || publisher) ocean->fill_heightfield(t, &frame);
+        }
+        if(recorder)  recorder->record(frame);
+        if(publisher) publisher->publish(frame);
+    }
+    const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    if(oceans.size()>1) std::cout << oceans.size() << " oceans, ";
+    std::cout << frames << " frames in " << elapsed << " s: " << frames/elapsed << " frames/s" << std::endl;
+    if(!cache && oceans.size()==1) ocean->print_timings(std::cout, frames);
+}
+
+/*
+Returns the key of the state file: the hash of every parameter the
+initial spectrum, the dispersion table and the foam depend on.
+*/
+const uint64_t state_key(Parameters* const p, const uint32_t seed) {
+    const double values[] = {p->num_val<double>("lx"), p->num_val<double>("ly"), static_cast<double>(p->num_val<int>("nx")), static_cast<double>(p->num_val<int>("ny")),
+                             p->num_val<double>("wind_speed"), static_cast<double>(p->num_val<int>("wind_alignment")), p->num_val<double>("min_wave_size"),
+                             p->num_val<double>("A"), p->num_val<double>("fetch"), p->num_val<double>("depth"), p->num_val<double>("choppiness"),
+                             static_cast<double>(p->num_val<int>("cascades")), p->num_val<double>("cascade_ratio"), p->is_spec("loop") ? p->num_val<double>("loop") : 0,
+                             static_cast<double>(seed)};
+    const std::string spectrum = p->cho_val("spectrum");
+    return StateCache::hash(spectrum.data(), spectrum.size(), StateCache::hash(values, sizeof(values)));
+}
+
+/*
+Returns the key of the loop cache file: the key of the state file, with the other
+parameters the frames depend on.
+*/
+const uint64_t loop_key(Parameters* const p, const uint32_t seed) {
+    const double values[] = {p->num_val<double>("motion_factor"), p->num_val<double>("mode_cutoff")};
+    return StateCache::hash(values, sizeof(values), state_key(p, seed));
+}
+
+/*
+Saves the state of the ocean at time t, and prints the error if any.
+*/
+const bool save_state(StateCache* const state, const double t) {
+    try {
+        state->save(t);
+    }
+    catch(const std::exception& e) {
+        std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+Prints the height of the ocean at the points of the given file for every frame.
+When there are few points, the heights are summed directly from the most energetic
+waves, and the error of this approximation is printed first. Otherwise, the whole
+ocean is computed with the FFT and sampled at the points, through the tiles if a
+tiling is given.
+*/
+void run_probes(Cascade* const ocean, const int frames, const double dt, const double start_time, const int nb_modes, const std::string& file, const Tiling* const tiling) {
+    std::ifstream      in(file);
+    std::vector<float> xs;
+    std::vector<float> zs;
+    float              x;
+    float              z;
+    while(in >> x >> z) {
+        xs.push_back(x);
+        zs.push_back(z);
+    }
+    if(xs.empty()) {
+        std::cerr << "error :" << std::endl << "   " << "no probe could be read from " << file << std::endl;
+        return;
+    }
+    std::vector<float> heights(xs.size());
+    SparseOcean*       sparse = nullptr;
+    if(!tiling && xs.size()<SparseOcean::break_even(nb_modes, ocean->get_nx(), ocean->get_ny(), ocean->get_nb_cascades())) {
+        sparse = new SparseOcean(ocean, nb_modes);
+        std::cout << "# direct sum of " << sparse->get_nb_modes() << " waves, " << 100*sparse->get_energy_fraction() << " % of the energy, error bound "
+                  << sparse->get_error_bound() << ", measured error " << sparse->measure_error(start_time, 64) << std::endl;
+    }
+    else {
+        std::cout << "# FFT" << std::endl;
+    }
+    for(int i=0 ; i<frames ; i++) {
+        const double t = start_time + i*dt;
+        if(sparse) {
+            sparse->set_time(t);
+            sparse->evaluate(xs.data(), zs.data(), heights.data(), xs.size());
+        }
+        else {
+            ocean->main_computation(t);
+            if(tiling) tiling->sample_heights(xs.data(), zs.data(), heights.data(), xs.size());
+            else       ocean->sample_heights(xs.data(), zs.data(), heights.data(), xs.size());
+        }
+        std::cout << t;
+        for(std::size_t j=0 ; j<heights.size() ; j++) std::cout << " " << heights[j];
+        std::cout << std::endl;
+    }
+    delete sparse;
+}
+
+/*
+Prints for every frame the distance from the origin of each ray of the given file
+to the surface, or -1 if the ray does not reach it within range. Each frame is
+computed with the FFT, and the rays walk down a min/max pyramid of its heights
+instead of scanning the grid, through the tiles if a tiling is given. The mean time
+to build the pyramid and to cast a ray is printed last.
+*/
+void run_rays(Cascade* const ocean, const int frames, const double dt, const double start_time, const double range, const std::string& file, const Tiling* const tiling) {
+    typedef std::chrono::steady_clock clock;
+    std::ifstream       in(file);
+    std::vector<double> rays;
+    double              r[6];
+    while(in >> r[0] >> r[1] >> r[2] >> r[3] >> r[4] >> r[5]) {
+        const double n = sqrt(r[3]*r[3] + r[4]*r[4] + r[5]*r[5]);
+        if(n<=0) continue;
+        for(int i=3 ; i<6 ; i++) r[i] /= n;
+        rays.insert(rays.end(), r, r+6);
+    }
+    if(rays.empty()) {
+        std::cerr << "error :" << std::endl << "   " << "no ray could be read from " << file << std::endl;
+        return;
+    }
+    std::vector<double> distances(rays.size()/6);
+    Heightfield         frame;
+    Pyramid             pyramid;
+    double              build = 0;
+    double              cast  = 0;
+    for(int i=0 ; i<frames ; i++) {
+        const double t = start_time + i*dt;
+        ocean->main_computation(t);
+        ocean->fill_heightfield(t, &frame);
+        const clock::time_point start = clock::now();
+        pyramid.build(frame, ocean->get_lx(), ocean->get_ly());
+        const clock::time_point built = clock::now();
+        for(std::size_t j=0 ; j<distances.size() ; j++) distances[j] = pyramid.intersect(&rays[6*j], &rays[6*j+3], range, tiling);
+        build += std::chrono::duration<double>(built - start).count();
+        cast  += std::chrono::duration<double>(clock::now() - built).count();
+        std::cout << t;
+        for(std::size_t j=0 ; j<distances.size() ; j++) std::cout << " " << distances[j];
+        std::cout << std::endl;
+    }
+    std::cout << "# pyramid " << 1000*build/frames << " ms, ray " << 1e6*cast/(frames*distances.size()) << " us" << std::endl;
+}
+
+/*
+Drops n boxes at random positions and headings on the ocean, at rest, and prints
+for every frame their mean height and the mean fraction of their volume under the
+water, as the waves move them. Each box weighs half the water it can displace,
+and has a grid of hull points, floating on the tiles if a tiling is given. The mean
+time of a step of the whole batch is printed last.
+*/
+void run_bodies(Host* const host, Cascade* const ocean, const int frames, const double dt, const double start_time, const int n, const uint32_t seed, const Tiling* const tiling) {
+    typedef std::chrono::steady_clock clock;
+    const double       density    = 1025;                 /* density of sea water */
+    const double       drag       = 1;                    /* drag rate of the water, in 1/s */
+    const float        size[3]    = {8, 2, 4};            /* length, height and width of a box */
+    const int          side[3]    = {4, 2, 2};            /* nb of hull points along them */
+    const int          nb         = side[0]*side[1]*side[2];
+    const float        volume     = size[0]*size[1]*size[2];
+    const float        mass       = density*volume/2;
+    const float        inertia[3] = {mass*(size[1]*size[1] + size[2]*size[2])/12, mass*(size[0]*size[0] + size[2]*size[2])/12, mass*(size[0]*size[0] + size[1]*size[1])/12};
+    std::vector<float> px;
+    std::vector<float> py;
+    std::vector<float> pz;
+    for(int c=0 ; c<side[2] ; c++) {
+        for(int b=0 ; b<side[1] ; b++) {
+            for(int a=0 ; a<side[0] ; a++) {
+                px.push_back(size[0]*((a+0.5f)/side[0] - 0.5f));
+                py.push_back(size[1]*((b+0.5f)/side[1] - 0.5f));
+                pz.push_back(size[2]*((c+0.5f)/side[2] - 0.5f));
+            }
+        }
+    }
+    Buoyancy::Bodies bodies;
+    const Philox     random(seed, 0xFFFFFFFE);
+    uint32_t         r[4];
+    for(int i=0 ; i<n ; i++) {
+        random(i, 0, 0, 0, r);
+        const float position[3] = {static_cast<float>(ocean->get_lx()*(r[0]/4294967296.0)), 0, static_cast<float>(ocean->get_ly()*(r[1]/4294967296.0))};
+        bodies.add(mass, inertia, position, 2*M_PI*(r[2]/4294967296.0), nb, px.data(), py.data(), pz.data(), volume/nb, size[1]/(2*side[1]));
+    }
+    Buoyancy buoyancy(ocean, host->get_pool(), density, drag, tiling);
+    double   elapsed = 0;
+    for(int i=0 ; i<frames ; i++) {
+        const double t = start_time + i*dt;
+        ocean->main_computation(t);
+        const clock::time_point start = clock::now();
+        buoyancy.step(&bodies, dt);
+        elapsed += std::chrono::duration<double>(clock::now() - start).count();
+        double height    = 0;
+        double submerged = 0;
+        for(int j=0 ; j<n ; j++) {
+            height    += bodies.y[j];
+            submerged += bodies.submerged[j];
+        }
+        std::cout << t << " " << height/n << " " << submerged/(n*volume) << std::endl;
+    }
+    std::cout << "# " << n << " bodies, step " << 1000*elapsed/frames << " ms" << std::endl;
+}
+
+/*
+Prints the memory held by each component of the oceans, by the FFT plans they
+share, by the nb_frames frames kept for the rendering or the output, and by the
+loop cache if any, in MB.
+*/
+void print_memory(Host* const host, const std::vector<Cascade*>& oceans, LoopCache* const cache, const int nb_frames, const bool hermite) {
+    const double MB = 1048576;
+    std::size_t  bytes[Ocean::NB_COMPONENTS] = {0};
+    for(std::size_t i=0 ; i<oceans.size() ; i++) oceans[i]->get_memory(bytes);
+    const std::size_t vertices = static_cast<std::size_t>(oceans[0]->get_frame_nx()+1)*(oceans[0]->get_frame_ny()+1);
+    const std::size_t frames   = nb_frames*vertices*sizeof(float)*(Heightfield::STRIDE + (hermite ? 1 : 0));
+    const std::size_t loop     = cache ? cache->get_size() : 0;
+    const std::size_t plans    = host->get_memory();
+    std::size_t       total    = frames + loop + plans;
+    std::cout << "Memory:" << std::endl;
+    for(int i=0 ; i<Ocean::NB_COMPONENTS ; i++) {
+        std::cout << "   " << Ocean::component_name(static_cast<Ocean::COMPONENT>(i)) << ": " << bytes[i]/MB << " MB" << std::endl;
+        total += bytes[i];
+    }
+    std::cout << "   FFT plans: " << plans/MB << " MB" << std::endl;
+    std::cout << "   frames (" << nb_frames << "): " << frames/MB << " MB" << std::endl;
+    if(cache) std::cout << "   loop cache: " << loop/MB << " MB" << std::endl;
+    std::cout << "   total: " << total/MB << " MB" << std::endl;
+}
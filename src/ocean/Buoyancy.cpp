@@ -0,0 +1,244 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Buoyancy.hpp"
+
+const double Buoyancy::G = 9.81;
+
+/*
+Adds a body of the given mass and principal moments of inertia, at the actual
+position of its center of mass, turned by heading radians about the vertical axis,
+at rest. Its n hull points are given relative to the center of mass, and all of
+them displace the same volume, submerged over twice the same radius. Returns the
+index of the body.
+*/
+const int Buoyancy::Bodies::add(const float p_mass, const float* const inertia, const float* const position, const float heading, const int n, const float* const p_px, const float* const p_py, const float* const p_pz, const float p_volume, const float p_radius) {
+    x.push_back(position[0]);
+    y.push_back(position[1]);
+    z.push_back(position[2]);
+    qw.push_back(cos(heading/2));
+    qx.push_back(0);
+    qy.push_back(sin(heading/2));
+    qz.push_back(0);
+    vx.push_back(0);
+    vy.push_back(0);
+    vz.push_back(0);
+    wx.push_back(0);
+    wy.push_back(0);
+    wz.push_back(0);
+    mass.push_back(p_mass);
+    ix.push_back(inertia[0]);
+    iy.push_back(inertia[1]);
+    iz.push_back(inertia[2]);
+    px.insert(px.end(), p_px, p_px+n);
+    py.insert(py.end(), p_py, p_py+n);
+    pz.insert(pz.end(), p_pz, p_pz+n);
+    volume.insert(volume.end(), n, p_volume);
+    radius.insert(radius.end(), n, p_radius);
+    first.push_back(first.back()+n);
+    submerged.push_back(0);
+    bx.push_back(position[0]);
+    by.push_back(position[1]);
+    bz.push_back(position[2]);
+    fx.push_back(0);
+    fy.push_back(0);
+    fz.push_back(0);
+    tx.push_back(0);
+    ty.push_back(0);
+    tz.push_back(0);
+    return size()-1;
+}
+
+/*
+Initializes the variables. The drag is given as a rate, in 1/s: a submerged volume
+V moving at the velocity v is slowed by the force density*rate*V*v. The bodies float
+on the tiles of p_tiling if it is given, on the periodic ocean otherwise.
+*/
+Buoyancy::Buoyancy(Cascade* const p_ocean, ThreadPool* const p_pool, const double p_density, const double p_drag, const Tiling* const p_tiling) :
+    ocean(p_ocean),
+    tiling(p_tiling),
+    pool(p_pool),
+    density(p_density),
+    drag(p_density*p_drag) {
+}
+
+/*
+Writes in r the rotation matrix of the unit quaternion q, row after row.
+*/
+inline void Buoyancy::matrix(const float qw, const float qx, const float qy, const float qz, float* const r) {
+    r[0] = 1 - 2*(qy*qy + qz*qz);
+    r[1] = 2*(qx*qy - qw*qz);
+    r[2] = 2*(qx*qz + qw*qy);
+    r[3] = 2*(qx*qy + qw*qz);
+    r[4] = 1 - 2*(qx*qx + qz*qz);
+    r[5] = 2*(qy*qz - qw*qx);
+    r[6] = 2*(qx*qz - qw*qy);
+    r[7] = 2*(qy*qz + qw*qx);
+    r[8] = 1 - 2*(qx*qx + qy*qy);
+}
+
+/*
+Computes the submerged volume, the center of buoyancy, the force and the torque
+of every body, against the current surface of the ocean.
+*/
+void Buoyancy::forces(Bodies* const bodies) {
+    const int n = bodies->size();
+    xs.resize(bodies->first[n]);
+    ys.resize(bodies->first[n]);
+    zs.resize(bodies->first[n]);
+    heights.resize(bodies->first[n]);
+    pool->run([&](const int k) { forces_block(bodies, k*BLOCK, std::min(n, (k+1)*BLOCK)); }, (n+BLOCK-1)/BLOCK);
+}
+
+/*
+Computes the forces and moves the bodies by dt seconds.
+*/
+void Buoyancy::step(Bodies* const bodies, const double dt) {
+    const int n = bodies->size();
+    forces(bodies);
+    pool->run([&](const int k) { integrate_block(bodies, k*BLOCK, std::min(n, (k+1)*BLOCK), dt); }, (n+BLOCK-1)/BLOCK);
+}
+
+/*
+Computes the forces of the bodies begin to end-1. The hull points of the block are
+moved to the world first, the water heights above all of them are then sampled at
+once, and the forces of the points are summed for each body. A point is submerged
+linearly from radius over the water to radius under it.
+*/
+void Buoyancy::forces_block(Bodies* const b, const int begin, const int end) {
+    const float g  = density*G;
+    const int   p0 = b->first[begin];
+    const int   p1 = b->first[end];
+    for(int i=begin ; i<end ; i++) {
+        const float x = b->x[i];
+        const float y = b->y[i];
+        const float z = b->z[i];
+        float       r[9];
+        matrix(b->qw[i], b->qx[i], b->qy[i], b->qz[i], r);
+        for(int j=b->first[i] ; j<b->first[i+1] ; j++) {
+            xs[j] = x + r[0]*b->px[j] + r[1]*b->py[j] + r[2]*b->pz[j];
+            ys[j] = y + r[3]*b->px[j] + r[4]*b->py[j] + r[5]*b->pz[j];
+            zs[j] = z + r[6]*b->px[j] + r[7]*b->py[j] + r[8]*b->pz[j];
+        }
+    }
+    if(tiling) tiling->sample_heights(&xs[p0], &zs[p0], &heights[p0], p1-p0);
+    else       ocean->sample_heights(&xs[p0], &zs[p0], &heights[p0], p1-p0);
+    for(int i=begin ; i<end ; i++) {
+        const float x   = b->x[i];
+        const float y   = b->y[i];
+        const float z   = b->z[i];
+        const float vx  = b->vx[i];
+        const float vy  = b->vy[i];
+        const float vz  = b->vz[i];
+        const float wx  = b->wx[i];
+        const float wy  = b->wy[i];
+        const float wz  = b->wz[i];
+        float       vol = 0;
+        float       mx  = 0;
+        float       my  = 0;
+        float       mz  = 0;
+        float       fx  = 0;
+        float       fy  = 0;
+        float       fz  = 0;
+        float       tx  = 0;
+        float       ty  = 0;
+        float       tz  = 0;
+        for(int j=b->first[i] ; j<b->first[i+1] ; j++) {
+            const float rx = xs[j] - x;
+            const float ry = ys[j] - y;
+            const float rz = zs[j] - z;
+            const float s  = std::min(1.0f, std::max(0.0f, (heights[j] - ys[j] + b->radius[j])/(2*b->radius[j])));
+            const float v  = s*b->volume[j];
+            const float ex = -drag*v*(vx + wy*rz - wz*ry);
+            const float ey = g*v - drag*v*(vy + wz*rx - wx*rz);
+            const float ez = -drag*v*(vz + wx*ry - wy*rx);
+            vol += v;
+            mx  += v*rx;
+            my  += v*ry;
+            mz  += v*rz;
+            fx  += ex;
+            fy  += ey;
+            fz  += ez;
+            tx  += ry*ez - rz*ey;
+            ty  += rz*ex - rx*ez;
+            tz  += rx*ey - ry*ex;
+        }
+        const float c = vol>0 ? 1/vol : 0;
+        b->submerged[i] = vol;
+        b->bx[i]        = x + c*mx;
+        b->by[i]        = y + c*my;
+        b->bz[i]        = z + c*mz;
+        b->fx[i]        = fx;
+        b->fy[i]        = fy;
+        b->fz[i]        = fz;
+        b->tx[i]        = tx;
+        b->ty[i]        = ty;
+        b->tz[i]        = tz;
+    }
+}
+
+/*
+Moves the bodies begin to end-1 by dt seconds with their forces and their weight.
+The velocities are updated first and move the bodies, which is stable for the
+stiff buoyancy. The torque is turned into the frame of the body, where the inertia
+is diagonal, and the angular acceleration back into the world. The orientation
+follows the derivative w.q/2 of its quaternion, and is normalized again.
+*/
+void Buoyancy::integrate_block(Bodies* const b, const int begin, const int end, const float dt) const {
+    for(int i=begin ; i<end ; i++) {
+        const float m = 1/b->mass[i];
+        float       r[9];
+        matrix(b->qw[i], b->qx[i], b->qy[i], b->qz[i], r);
+        const float lx = (r[0]*b->tx[i] + r[3]*b->ty[i] + r[6]*b->tz[i])/b->ix[i];
+        const float ly = (r[1]*b->tx[i] + r[4]*b->ty[i] + r[7]*b->tz[i])/b->iy[i];
+        const float lz = (r[2]*b->tx[i] + r[5]*b->ty[i] + r[8]*b->tz[i])/b->iz[i];
+        b->vx[i] += dt*m*b->fx[i];
+        b->vy[i] += dt*(m*b->fy[i] - static_cast<float>(G));
+        b->vz[i] += dt*m*b->fz[i];
+        b->wx[i] += dt*(r[0]*lx + r[1]*ly + r[2]*lz);
+        b->wy[i] += dt*(r[3]*lx + r[4]*ly + r[5]*lz);
+        b->wz[i] += dt*(r[6]*lx + r[7]*ly + r[8]*lz);
+        b->x[i]  += dt*b->vx[i];
+        b->y[i]  += dt*b->vy[i];
+        b->z[i]  += dt*b->vz[i];
+        const float wx = b->wx[i];
+        const float wy = b->wy[i];
+        const float wz = b->wz[i];
+        const float qw = b->qw[i];
+        const float qx = b->qx[i];
+        const float qy = b->qy[i];
+        const float qz = b->qz[i];
+        const float nw = qw - dt/2*(wx*qx + wy*qy + wz*qz);
+        const float nx = qx + dt/2*(wx*qw + wy*qz - wz*qy);
+        const float ny = qy + dt/2*(wy*qw + wz*qx - wx*qz);
+        const float nz = qz + dt/2*(wz*qw + wx*qy - wy*qx);
+        const float s  = 1/sqrt(nw*nw + nx*nx + ny*ny + nz*nz);
+        b->qw[i] = s*nw;
+        b->qx[i] = s*nx;
+        b->qy[i] = s*ny;
+        b->qz[i] = s*nz;
+    }
+}
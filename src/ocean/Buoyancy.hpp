@@ -0,0 +1,125 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class moves rigid bodies floating on the ocean, such as ships or debris, in
+batches of thousands. The bodies are stored as a structure of arrays, and each one
+is described by the hull points of its own slice of the point arrays: every point
+displaces a small volume of water, which is submerged progressively as the surface
+rises from radius under the point to radius over it. The water height above every
+point is sampled from the cascade, with its horizontal displacements if the waves
+are choppy, so that no consumer needs its own copy of the grid, or from the tiles
+of an infinite ocean.
+The forces are the buoyancy of the submerged volume of each point, pushing up at
+the point, and a linear drag against the still water, proportional to the volume
+and to the velocity of the point. They give the submerged volume of each body, its
+center of buoyancy, and the force and torque about its center of mass. The bodies
+are then integrated with a semi-implicit Euler step, the inertia being diagonal in
+the frame of the body. The batch is cut into blocks of BLOCK bodies computed by the
+thread pool, and the points of a block go through contiguous loops that the
+compiler can vectorize.
+*/
+
+#ifndef BUOYANCYHPP
+#define BUOYANCYHPP
+
+#include <vector>
+
+#include "parallel/ThreadPool.hpp"
+#include "Cascade.hpp"
+#include "Tiling.hpp"
+
+class Buoyancy {
+
+    public:
+
+        struct Bodies {
+            std::vector<float> x;           /* actual position of the center of mass */
+            std::vector<float> y;
+            std::vector<float> z;
+            std::vector<float> qw;          /* orientation, a unit quaternion from the body to the world */
+            std::vector<float> qx;
+            std::vector<float> qy;
+            std::vector<float> qz;
+            std::vector<float> vx;          /* velocity of the center of mass */
+            std::vector<float> vy;
+            std::vector<float> vz;
+            std::vector<float> wx;          /* angular velocity, in the world */
+            std::vector<float> wy;
+            std::vector<float> wz;
+            std::vector<float> mass;
+            std::vector<float> ix;          /* principal moments of inertia, along the axes of the body */
+            std::vector<float> iy;
+            std::vector<float> iz;
+            std::vector<int>   first;       /* first hull point of each body, the last one ending the points */
+            std::vector<float> px;          /* hull points, relative to the center of mass, in the body */
+            std::vector<float> py;
+            std::vector<float> pz;
+            std::vector<float> volume;      /* volume of water displaced by each point when submerged */
+            std::vector<float> radius;      /* half the height over which each point gets submerged */
+            std::vector<float> submerged;   /* submerged volume of each body, computed by forces() */
+            std::vector<float> bx;          /* center of buoyancy, where the body is submerged */
+            std::vector<float> by;
+            std::vector<float> bz;
+            std::vector<float> fx;          /* force on the center of mass, without the weight */
+            std::vector<float> fy;
+            std::vector<float> fz;
+            std::vector<float> tx;          /* torque about the center of mass, in the world */
+            std::vector<float> ty;
+            std::vector<float> tz;
+
+            Bodies() : first(1, 0) {}
+
+            const int size() const { return static_cast<int>(mass.size()); }
+            const int add(const float, const float* const, const float* const, const float, const int, const float* const, const float* const, const float* const, const float, const float);
+        };
+
+        Buoyancy(Cascade* const, ThreadPool* const, const double, const double, const Tiling* const=nullptr);
+        ~Buoyancy() {}
+
+        void forces(Bodies* const);
+        void step(Bodies* const, const double);
+
+    private:
+
+        static const double G;               /* gravity */
+        static const int    BLOCK = 256;     /* nb of bodies per task */
+
+        void forces_block(Bodies* const, const int, const int);
+        void integrate_block(Bodies* const, const int, const int, const float) const;
+
+        static inline void matrix(const float, const float, const float, const float, float* const);
+
+        Cascade* const      ocean;       /* surface under the bodies */
+        const Tiling* const tiling;      /* tiles of the ocean under the bodies, or nullptr */
+        ThreadPool* const   pool;        /* threads computing the blocks */
+        const float         density;     /* density of the water */
+        const float         drag;        /* drag per submerged volume and per velocity */
+        std::vector<float>  xs;          /* actual position of every hull point */
+        std::vector<float>  ys;
+        std::vector<float>  zs;
+        std::vector<float>  heights;     /* height of the water above every hull point */
+
+};
+
+#endif
@@ -0,0 +1,397 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include "Cascade.hpp"
+#include "Height.hpp"
+#include "Host.hpp"
+#include "Spectrum.hpp"
+
+/*
+Creates the cascades on the given host, which gives their threads and FFT
+plans. The i-th cascade is ratio^i times smaller than the first one, and all
+of them have the same number of points.
+*/
+Cascade::Cascade(Host* const p_host, const double p_lx, const double p_ly, const int p_nx, const int p_ny, const int p_nb_cascades, const double p_ratio, const double p_motion_factor, const double p_choppiness, const double p_foam_threshold, const double p_foam_decay, const bool p_with_velocity, const double p_mode_cutoff, const double p_depth) :
+    lx(p_lx),
+    ly(p_ly),
+    nx(p_nx),
+    ny(p_ny),
+    ratio(p_ratio),
+    detail(frame_detail(p_nx, p_ny, p_nb_cascades, p_ratio)),
+    motion_factor(p_motion_factor),
+    choppiness(p_choppiness),
+    foam_threshold(p_foam_threshold),
+    foam_decay(p_foam_decay),
+    with_velocity(p_with_velocity),
+    mode_cutoff(p_mode_cutoff),
+    depth(p_depth),
+    host(p_host),
+    fade_time(0),
+    regenerating(false),
+    requested(false),
+    pending_fade(0),
+    pending(false) {
+    spectrum.model          = Spectrum::PHILIPPS;
+    spectrum.wind_speed     = 0;
+    spectrum.wind_alignment = 0;
+    spectrum.min_wave_size  = 0;
+    spectrum.A              = 0;
+    spectrum.fetch          = 0;
+    spectrum.seed           = 0;
+    for(int i=0 ; i<p_nb_cascades ; i++) {
+        const double scale = pow(ratio, i);
+        oceans.push_back(new Ocean(lx/scale, ly/scale, nx, ny, motion_factor, choppiness, foam_threshold, foam_decay, with_velocity, mode_cutoff, depth, host->get_plan(nx), host->get_plan(ny)));
+    }
+}
+
+/*
+Waits for the spectra being computed, and frees memory.
+*/
+Cascade::~Cascade() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requested = false;
+    }
+    if(regenerator.joinable()) regenerator.join();
+    for(std::size_t i=0 ; i<oceans.size() ; i++) delete oceans[i];
+}
+
+/*
+Creates a new cascade on the same host, with the same parameters and the same initial spectra.
+*/
+Cascade* Cascade::clone() const {
+    Cascade* const c = new Cascade(host, lx, ly, nx, ny, get_nb_cascades(), ratio, motion_factor, choppiness, foam_threshold, foam_decay, with_velocity, mode_cutoff, depth);
+    for(std::size_t i=0 ; i<oceans.size() ; i++) c->oceans[i]->copy_spectrum(*oceans[i]);
+    return c;
+}
+
+/*
+Returns the factor by which the grid of the cascades is refined for the frames: the
+smallest power of 2 giving the spacing of the smallest cascade, or less if the frame
+would have more than MAX_FRAME_SIZE subdivisions. A single cascade is not refined.
+*/
+const int Cascade::frame_detail(const int nx, const int ny, const int nb_cascades, const double ratio) {
+    const double finest = pow(ratio, nb_cascades-1);
+    int          d      = 1;
+    while(d<finest && 2*d*std::max(nx, ny)<=MAX_FRAME_SIZE) d *= 2;
+    return d;
+}
+
+/*
+Returns the wave number separating the cascades i and i+1. This is half the
+Nyquist wave number of the cascade i, which is still well resolved by its grid,
+and is above the fundamental wave number of the cascade i+1 as long as the
+ratio is below n/4.
+*/
+const double Cascade::band_limit(const int i) const {
+    const double scale = pow(ratio, i);
+    return M_PI*std::min(nx*scale/lx, ny*scale/ly)/2;
+}
+
+/*
+Returns the wave number from which the waves of the cascade i are removed: its band
+limit, or the Nyquist wave number of the frame when the grid of the cascade is finer
+than the frame, since the frame would alias the shorter waves into longer ones.
+*/
+const double Cascade::band_end(const int i) const {
+    const double k = i==get_nb_cascades()-1 ? std::numeric_limits<double>::infinity() : band_limit(i);
+    if(pow(ratio, i)<=detail) return k;
+    return std::min(k, M_PI*detail*std::min(nx/lx, ny/ly));
+}
+
+/*
+Sets the parameters of the spectrum of the waves, see Spectrum. Nothing is
+computed before generate_height() or regenerate() is called.
+*/
+void Cascade::set_spectrum(const Spectrum::MODEL model, const double wind_speed, const int wind_alignment, const double min_wave_size, const double A, const double fetch, const uint32_t seed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spectrum.model          = model;
+    spectrum.wind_speed     = wind_speed;
+    spectrum.wind_alignment = wind_alignment;
+    spectrum.min_wave_size  = min_wave_size;
+    spectrum.A              = A;
+    spectrum.fetch          = fetch;
+    spectrum.seed           = seed;
+}
+
+/*
+Computes the initial height field of every cascade from its band of the
+spectrum. Each cascade draws its random numbers from its own stream of the
+seed, and is computed by all the threads of the host at once.
+*/
+void Cascade::generate_height() {
+    const int           nb = get_nb_cascades();
+    spectrum_parameters p;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        p = spectrum;
+    }
+    for(int i=0 ; i<nb ; i++) {
+        const double k_min = i==0    ? 0 : band_limit(i-1);
+        const double k_max = band_end(i);
+        Spectrum     s(p.model, oceans[i]->get_lx(), oceans[i]->get_ly(), nx, ny, p.wind_speed, p.wind_alignment, p.min_wave_size, p.A, p.fetch, depth, k_min, k_max);
+        Height       height(s, ny, p.seed, i);
+        oceans[i]->generate_height(height, host->get_pool());
+    }
+}
+
+/*
+Computes the initial height field of every cascade from its band of the
+spectrum into R and I, without changing the oceans. Each cascade draws its
+random numbers from its own stream of the seed.
+*/
+void Cascade::generate_spectra(const spectrum_parameters& p, ThreadPool* const threads, std::vector<Ocean::vec_vec_d>* const R, std::vector<Ocean::vec_vec_d>* const I) const {
+    const int nb = get_nb_cascades();
+    R->resize(nb);
+    I->resize(nb);
+    for(int i=0 ; i<nb ; i++) {
+        const double k_min = i==0    ? 0 : band_limit(i-1);
+        const double k_max = band_end(i);
+        Spectrum     s(p.model, oceans[i]->get_lx(), oceans[i]->get_ly(), nx, ny, p.wind_speed, p.wind_alignment, p.min_wave_size, p.A, p.fetch, depth, k_min, k_max);
+        Height       height(s, ny, p.seed, i);
+        oceans[i]->generate_spectrum(height, threads, &(*R)[i], &(*I)[i]);
+    }
+}
+
+/*
+Asks for new spectra with the given wind speed, wind alignment, minimum wave
+size and A, the other parameters and the seed being kept. They are computed by
+a background thread, and the oceans fade to them in fade seconds from the first
+frame computed after. When several changes come faster than the spectra are
+computed, only the latest one is computed next.
+*/
+void Cascade::regenerate(const double wind_speed, const int wind_alignment, const double min_wave_size, const double A, const double fade) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spectrum.wind_speed     = wind_speed;
+    spectrum.wind_alignment = wind_alignment;
+    spectrum.min_wave_size  = min_wave_size;
+    spectrum.A              = A;
+    fade_time               = fade;
+    requested               = true;
+    if(regenerating) return;
+    if(regenerator.joinable()) regenerator.join();
+    regenerating = true;
+    regenerator  = std::thread(&Cascade::regeneration_loop, this);
+}
+
+/*
+Loop of the background thread: computes the latest spectra asked with one
+thread, so that the simulation keeps its cores, until no new one is asked.
+*/
+void Cascade::regeneration_loop() {
+    ThreadPool threads(1);
+    while(true) {
+        spectrum_parameters p;
+        double              fade;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!requested) {
+                regenerating = false;
+                return;
+            }
+            p         = spectrum;
+            fade      = fade_time;
+            requested = false;
+        }
+        std::vector<Ocean::vec_vec_d> R;
+        std::vector<Ocean::vec_vec_d> I;
+        generate_spectra(p, &threads, &R, &I);
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_R.swap(R);
+        pending_I.swap(I);
+        pending_fade = fade;
+        pending      = true;
+    }
+}
+
+/*
+Makes every cascade periodic in time with the given period.
+*/
+void Cascade::quantize_dispersion(const double period) {
+    for(std::size_t i=0 ; i<oceans.size() ; i++) oceans[i]->quantize_dispersion(period);
+}
+
+/*
+If new spectra were computed since the last frame, the oceans start to fade to them.
+*/
+void Cascade::start_fade() {
+    if(!pending.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for(std::size_t i=0 ; i<oceans.size() ; i++) oceans[i]->fade_to(&pending_R[i], &pending_I[i], pending_fade);
+    std::vector<Ocean::vec_vec_d>().swap(pending_R);
+    std::vector<Ocean::vec_vec_d>().swap(pending_I);
+    pending = false;
+}
+
+/*
+Computes all the cascades at time t concurrently, with the threads of the host.
+See Host::main_computation() to compute several oceans at once.
+*/
+void Cascade::main_computation(const double t) {
+    start_fade();
+    host->get_pool()->run([this, t](const int i) { oceans[i]->main_computation(t); }, get_nb_cascades());
+}
+
+/*
+Prints the timings of each cascade.
+*/
+void Cascade::print_timings(std::ostream& os, const int frames) const {
+    for(std::size_t i=0 ; i<oceans.size() ; i++) {
+        if(oceans.size()>1) os << "cascade " << i << " (" << oceans[i]->get_lx() << " x " << oceans[i]->get_ly() << "):" << std::endl;
+        oceans[i]->print_timings(os, frames);
+    }
+}
+
+/*
+Prints the number of waves updated at each frame by every cascade,
+and the fraction of the energy of the spectrum they hold.
+*/
+void Cascade::print_modes(std::ostream& os) const {
+    for(std::size_t i=0 ; i<oceans.size() ; i++) {
+        if(oceans.size()>1) os << "cascade " << i << ": ";
+        os << oceans[i]->get_nb_active_modes() << " active wave pairs, " << 100*oceans[i]->get_energy_fraction() << " % of the energy" << std::endl;
+    }
+}
+
+/*
+Adds the nb of bytes held by each component of all the cascades to bytes, an
+array of Ocean::NB_COMPONENTS sizes. The new spectra waiting to be faded to
+count with the initial spectra.
+*/
+void Cascade::get_memory(std::size_t* const bytes) const {
+    for(std::size_t i=0 ; i<oceans.size() ; i++) oceans[i]->get_memory(bytes);
+    std::lock_guard<std::mutex> lock(mutex);
+    for(std::size_t i=0 ; i<pending_R.size() ; i++) {
+        for(std::size_t x=0 ; x<pending_R[i].size() ; x++) bytes[Ocean::INITIAL_SPECTRUM] += sizeof(double)*(pending_R[i][x].capacity() + pending_I[i][x].capacity());
+    }
+}
+
+/*
+Writes the positions of the row y of vertices of the frame into a buffer with the
+layout of a Heightfield, and the time derivatives of their heights into rates if
+not null. When the frame has the grid of the first cascade, this cascade gives the
+values on its grid, and the smaller cascades are sampled at the same points.
+Otherwise, all the cascades are sampled along the row of the frame, with bicubic
+heights, which keep the waves down to a few points of their grid.
+*/
+void Cascade::frame_row(const int y, float* const vertices, float* const rates) const {
+    const int          S     = Heightfield::STRIDE;
+    const int          mx    = nx*detail;
+    const float        sx    = lx/mx;
+    const float        z     = (ly/(ny*detail))*y;
+    const int          first = detail==1 ? 1 : 0;
+    if(detail==1) {
+        oceans[0]->vertex_row(y, vertices);
+        if(rates) oceans[0]->rate_row(y, rates);
+        if(oceans.size()==1) return;
+    }
+    std::vector<float> h(mx+1, 0.0f);
+    std::vector<float> dx(mx+1, 0.0f);
+    std::vector<float> dz(mx+1, 0.0f);
+    if(detail==1) {
+        for(int x=0 ; x<=mx ; x++) {
+            dx[x] = vertices[S*x]   - sx*x;
+            h[x]  = vertices[S*x+1];
+            dz[x] = vertices[S*x+2] - z;
+        }
+    }
+    else if(rates) {
+        std::fill(rates, rates+mx+1, 0.0f);
+    }
+    for(std::size_t i=first ; i<oceans.size() ; i++) oceans[i]->add_row(z, sx, mx+1, h.data(), dx.data(), dz.data(), rates);
+    for(int x=0 ; x<=mx ; x++) {
+        vertices[S*x]   = sx*x + dx[x];
+        vertices[S*x+1] = h[x];
+        vertices[S*x+2] = z + dz[x];
+    }
+}
+
+/*
+Fills the given frame with the surface computed by the last call to
+main_computation(), which was done for the time t. The time derivative
+of the heights is added when the oceans compute it. The rows are shared
+among the threads of the host by groups of FRAME_ROWS, first for their
+positions, then for their normals, which need the rows around them.
+*/
+void Cascade::fill_heightfield(const double t, Heightfield* const frame) const {
+    const bool with_rates = oceans[0]->has_velocity();
+    const int  mx         = nx*detail;
+    const int  my         = ny*detail;
+    const int  tasks      = (my+FRAME_ROWS)/FRAME_ROWS;
+    frame->nx   = mx;
+    frame->ny   = my;
+    frame->time = t;
+    frame->vertices.resize(Heightfield::STRIDE*(mx+1)*(my+1));
+    if(with_rates) frame->rates.resize((mx+1)*(my+1));
+    host->get_pool()->run([this, frame, with_rates, mx, my](const int i) {
+        for(int y=FRAME_ROWS*i ; y<=std::min(my, FRAME_ROWS*(i+1)-1) ; y++) {
+            frame_row(y, frame->row(y), with_rates ? &frame->rates[(mx+1)*y] : nullptr);
+        }
+    }, tasks);
+    host->get_pool()->run([this, frame, my](const int i) {
+        for(int y=FRAME_ROWS*i ; y<=std::min(my, FRAME_ROWS*(i+1)-1) ; y++) frame->compute_normals(y, lx, ly);
+    }, tasks);
+}
+
+/*
+Computes the height of the ocean at n actual positions, as the sum of the heights
+of all the cascades. With choppy waves, the surface point seen at (x, z) comes
+from the point p such that p + D(p) = (x, z), D being the sum of the displacements
+of all the cascades, as for the rendered surface. It is found with a few
+fixed-point iterations p = (x, z) - D(p), and the heights of all the cascades are
+then summed at p. The positions are processed by blocks so that the intermediate
+values stay in the cache and the loops can be vectorized.
+This must not be called while main_computation() is running.
+*/
+void Cascade::sample_heights(const float* const xs, const float* const zs, float* const out, const std::size_t n, const Ocean::INTERPOLATION interpolation) const {
+    const int B = Ocean::SAMPLE_BLOCK;
+    float     px[B];
+    float     pz[B];
+    float     dx[B];
+    float     dz[B];
+    std::fill(out, out+n, 0.0f);
+    if(choppiness==0) {
+        for(std::size_t i=0 ; i<oceans.size() ; i++) oceans[i]->add_heights(xs, zs, out, n, interpolation);
+        return;
+    }
+    for(std::size_t i=0 ; i<n ; i+=B) {
+        const int m = static_cast<int>(std::min<std::size_t>(B, n-i));
+        std::copy(xs+i, xs+i+m, px);
+        std::copy(zs+i, zs+i+m, pz);
+        for(int k=0 ; k<Ocean::CHOPPY_ITERATIONS ; k++) {
+            std::fill(dx, dx+m, 0.0f);
+            std::fill(dz, dz+m, 0.0f);
+            for(std::size_t c=0 ; c<oceans.size() ; c++) oceans[c]->add_displacements(px, pz, dx, dz, m);
+            for(int j=0 ; j<m ; j++) {
+                px[j] = xs[i+j] - dx[j];
+                pz[j] = zs[i+j] - dz[j];
+            }
+        }
+        for(std::size_t c=0 ; c<oceans.size() ; c++) oceans[c]->add_heights(px, pz, out+i, m, interpolation);
+    }
+}
@@ -0,0 +1,140 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class implements a multi-cascade ocean. A single ocean either repeats itself
+visibly or needs a lot of points to have both details and extent. Here, several
+oceans of decreasing sizes (lx, lx/ratio, lx/ratio^2...) share the same spectrum:
+each of them only keeps the band of wave numbers its grid resolves best, so that no
+wave is counted twice. The oceans are computed concurrently, and summed when the
+surface is sampled. The first cascade is the largest one. The frames are drawn on its
+grid refined by a power of 2, up to the spacing of the smallest cascade if the frame
+stays below MAX_FRAME_SIZE points a side, and the waves of a cascade which the frame
+cannot show are removed from its band rather than aliased into longer waves.
+A cascade can be cloned, for several threads to compute the same ocean at different times.
+The wind and the size of the waves can be changed while the ocean runs: the new spectra
+are computed by a background thread, and the oceans fade to them from the next frame.
+The threads and the FFT plans come from a host, which many cascades can share.
+*/
+
+#ifndef CASCADEHPP
+#define CASCADEHPP
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel/ThreadPool.hpp"
+#include "Heightfield.hpp"
+#include "Ocean.hpp"
+
+class Host;
+
+class Cascade {
+
+    public:
+
+        Cascade(Host* const, const double, const double, const int, const int, const int, const double, const double, const double, const double, const double, const bool, const double, const double);
+        ~Cascade();
+
+        const double get_lx() { return lx; }
+        const double get_ly() { return ly; }
+        const int    get_nx() { return nx; }
+        const int    get_ny() { return ny; }
+        const int    get_frame_nx() const { return nx*detail; }
+        const int    get_frame_ny() const { return ny*detail; }
+
+        const int    get_nb_cascades()         const { return static_cast<int>(oceans.size()); }
+        Ocean*       get_ocean(const int i)    const { return oceans[i]; }
+
+        Cascade* clone() const;
+        void set_spectrum(const Spectrum::MODEL, const double, const int, const double, const double, const double, const uint32_t);
+        void generate_height();
+        void regenerate(const double, const int, const double, const double, const double);
+        void quantize_dispersion(const double);
+        void start_fade();
+        void main_computation(const double);
+        void print_timings(std::ostream&, const int) const;
+        void print_modes(std::ostream&) const;
+        void get_memory(std::size_t* const) const;
+        void frame_row(const int, float* const, float* const) const;
+        void fill_heightfield(const double, Heightfield* const) const;
+        void sample_heights(const float* const, const float* const, float* const, const std::size_t, const Ocean::INTERPOLATION=Ocean::BILINEAR) const;
+
+    private:
+
+        static const int MAX_FRAME_SIZE = 1024;   /* nb of frame subdivisions up to which the grid is refined */
+        static const int FRAME_ROWS     = 16;     /* nb of frame rows per task of fill_heightfield() */
+
+        struct spectrum_parameters {
+            Spectrum::MODEL model;            /* see Spectrum */
+            double          wind_speed;
+            int             wind_alignment;
+            double          min_wave_size;
+            double          A;
+            double          fetch;
+            uint32_t        seed;             /* seed of the random waves */
+        };
+
+        static const int frame_detail(const int, const int, const int, const double);
+
+        const double band_limit(const int) const;
+        const double band_end(const int) const;
+        void generate_spectra(const spectrum_parameters&, ThreadPool* const, std::vector<Ocean::vec_vec_d>* const, std::vector<Ocean::vec_vec_d>* const) const;
+        void regeneration_loop();
+
+        const double        lx;       /* actual width of the largest cascade */
+        const double        ly;       /* actual height of the largest cascade */
+        const int           nx;       /* nb of x points of every cascade - must be a power of 2 */
+        const int           ny;       /* nb of y points of every cascade - must be a power of 2 */
+        const double        ratio;    /* size ratio between two consecutive cascades */
+        const int           detail;   /* nb of frame subdivisions per subdivision of the cascades */
+
+        const double        motion_factor;    /* parameters of the oceans, see Ocean */
+        const double        choppiness;
+        const double        foam_threshold;
+        const double        foam_decay;
+        const bool          with_velocity;
+        const double        mode_cutoff;
+        const double        depth;
+
+        Host* const         host;     /* threads and FFT plans */
+        std::vector<Ocean*> oceans;   /* the cascades, from the largest to the smallest */
+
+        spectrum_parameters           spectrum;       /* parameters of the latest spectrum asked */
+        double                        fade_time;      /* duration of the transition to the latest spectrum asked */
+        std::thread                   regenerator;    /* computes the new spectra in the background */
+        mutable std::mutex            mutex;          /* protects the variables below */
+        bool                          regenerating;   /* true while the regenerator runs */
+        bool                          requested;      /* true if the regenerator has to compute the spectra again */
+        std::vector<Ocean::vec_vec_d> pending_R;      /* new spectra not faded to yet - real parts */
+        std::vector<Ocean::vec_vec_d> pending_I;      /* new spectra not faded to yet - imaginary parts */
+        double                        pending_fade;   /* duration of the transition to the new spectra */
+        std::atomic<bool>             pending;        /* true if there are new spectra */
+
+};
+
+#endif
@@ -0,0 +1,334 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef WITH_ZSTD
+    #include <zstd.h>
+#endif
+
+#include "Codec.hpp"
+
+namespace {
+
+    /* maps a difference of 16-bit values to a small unsigned value, 0 -1 1 -2 2... */
+    inline uint16_t zigzag(const int d) {
+        const int16_t s = static_cast<int16_t>(static_cast<uint16_t>(d));
+        return static_cast<uint16_t>((s << 1) ^ (s >> 15));
+    }
+
+    inline int unzigzag(const uint16_t u) {
+        return (u >> 1) ^ -(u & 1);
+    }
+
+    /* quantized value back to a float, the same way for the encoder and the decoder */
+    inline float dequantize(const float base, const float step, const int c) {
+        return base + static_cast<float>(c)*step;
+    }
+
+    /* writes bits from the least significant one */
+    struct BitWriter {
+        std::vector<unsigned char>* out;
+        uint64_t                    bits;
+        int                         nb;
+        BitWriter(std::vector<unsigned char>* const p_out) : out(p_out), bits(0), nb(0) {}
+        void put(const uint32_t value, const int n) {
+            bits |= static_cast<uint64_t>(value) << nb;
+            nb   += n;
+            while(nb>=8) {
+                out->push_back(static_cast<unsigned char>(bits));
+                bits >>= 8;
+                nb    -= 8;
+            }
+        }
+        void flush() { if(nb>0) out->push_back(static_cast<unsigned char>(bits)); }
+    };
+
+    /* reads bits from the least significant one, zeros past the end */
+    struct BitReader {
+        const unsigned char* data;
+        std::size_t          size;
+        std::size_t          pos;
+        uint64_t             bits;
+        int                  nb;
+        BitReader(const unsigned char* const p_data, const std::size_t p_size) : data(p_data), size(p_size), pos(0), bits(0), nb(0) {}
+        void fill() {
+            while(nb<=56) {
+                bits |= static_cast<uint64_t>(pos<size ? data[pos] : 0) << nb;
+                pos++;
+                nb  += 8;
+            }
+        }
+        uint32_t peek(const int n)      { fill(); return static_cast<uint32_t>(bits & ((1ULL << n) - 1)); }
+        void     skip(const int n)      { bits >>= n; nb -= n; }
+        uint32_t get(const int n)       { const uint32_t v = peek(n); skip(n); return v; }
+        bool     overrun() const        { return 8*pos - nb>8*size; }
+    };
+
+}
+
+/*
+Initializes the variables for frames of nb_channels planes of (ny+1) rows of
+(nx+1) values, as recorded. The values are decoded within max_error.
+*/
+Codec::Codec(const int nx, const int ny, const int p_nb_channels, const double p_max_error, const ENTROPY p_entropy) :
+    width(nx+1),
+    height(ny+1),
+    nb_channels(p_nb_channels),
+    nb_tiles((ny+1 + TILE_ROWS-1)/TILE_ROWS),
+    max_error(static_cast<float>(p_max_error)),
+    entropy(p_entropy),
+    frame(0),
+    previous(static_cast<std::size_t>(p_nb_channels)*(nx+1)*(ny+1), 0),
+    bands(p_nb_channels*nb_tiles),
+    symbols(p_nb_channels*nb_tiles) {
+}
+
+/*
+Returns true if the program is built with zstd.
+*/
+const bool Codec::has_zstd() {
+    #ifdef WITH_ZSTD
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+/*
+Gives the position of the values of band b in a frame, and their number.
+*/
+void Codec::band_range(const int b, std::size_t* const offset, std::size_t* const n) const {
+    const int channel = b/nb_tiles;
+    const int row     = (b%nb_tiles)*TILE_ROWS;
+    *offset = (static_cast<std::size_t>(channel)*height + row)*width;
+    *n      = static_cast<std::size_t>(std::min(TILE_ROWS, height-row))*width;
+}
+
+/*
+Codes the given frame after the previous ones. The bands are coded by the pool.
+*/
+void Codec::encode(const float* const in, std::vector<unsigned char>* const out, ThreadPool* const pool) {
+    const bool     key = frame%KEY_INTERVAL==0;
+    const uint32_t nb  = static_cast<uint32_t>(bands.size());
+    pool->run([&](const int b) { encode_band(b, in, key); }, nb);
+    out->resize(sizeof(uint32_t)*(2+nb));
+    uint32_t* const head = reinterpret_cast<uint32_t*>(out->data());
+    head[0] = key ? 1 : 0;
+    head[1] = nb;
+    for(uint32_t b=0 ; b<nb ; b++) head[2+b] = static_cast<uint32_t>(bands[b].size());
+    for(uint32_t b=0 ; b<nb ; b++) out->insert(out->end(), bands[b].begin(), bands[b].end());
+    frame++;
+}
+
+/*
+Quantizes band b of the frame, updates the decoded frame and codes the quantized
+values. A key frame predicts each value by the previous one of the band, and the
+other frames predict the difference with the decoded frame by zero. When the range
+of the band needs more than 16 bits with a step of twice the maximum error, or when
+the rounding of the floats takes a decoded value out of the error, the band is
+stored as raw floats instead, with a zero step, so that the error always holds.
+*/
+void Codec::encode_band(const int b, const float* const in, const bool key) {
+    std::size_t offset;
+    std::size_t n;
+    band_range(b, &offset, &n);
+    const float* const      v   = in + offset;
+    float* const            r   = previous.data() + offset;
+    std::vector<uint16_t>&  sym = symbols[b];
+    float                   lo  = key ? v[0] : v[0]-r[0];
+    float                   hi  = lo;
+    for(std::size_t i=0 ; i<n ; i++) {
+        const float d = key ? v[i] : v[i]-r[i];
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    const float step = 2*max_error*0.999f;   /* keeps the float rounding within the error */
+    const float inv  = 1/step;
+    int         pred = key ? 0 : static_cast<int>(lrintf(-lo/step));
+    bool        raw  = (hi-lo)*inv>65535;
+    sym.resize(n);
+    for(std::size_t i=0 ; i<n && !raw ; i++) {
+        const float d = key ? v[i] : v[i]-r[i];
+        const int   c = std::min(65535, std::max(0, static_cast<int>(lrintf((d-lo)*inv))));
+        sym[i] = zigzag(c - pred);
+        if(key) {
+            r[i] = dequantize(lo, step, c);
+            pred = c;
+        }
+        else {
+            r[i] += dequantize(lo, step, c);
+        }
+        raw = fabsf(v[i]-r[i])>max_error;
+    }
+    std::vector<unsigned char>& out  = bands[b];
+    const float                 zero = 0;
+    out.resize(2*sizeof(float));
+    memcpy(out.data(), &lo, sizeof(float));
+    memcpy(out.data() + sizeof(float), raw ? &zero : &step, sizeof(float));
+    if(raw) {
+        std::copy(v, v+n, r);
+        out.resize(2*sizeof(float) + n*sizeof(float));
+        memcpy(out.data() + 2*sizeof(float), v, n*sizeof(float));
+    }
+    else if(entropy==RICE) {
+        rice_encode(sym, &out);
+    }
+    #ifdef WITH_ZSTD
+    else {
+        const std::size_t header = out.size();
+        out.resize(header + ZSTD_compressBound(2*n));
+        const std::size_t size = ZSTD_compress(out.data() + header, out.size() - header, sym.data(), 2*n, 1);
+        out.resize(header + (ZSTD_isError(size) ? 0 : size));
+    }
+    #endif
+}
+
+/*
+Decodes the given coded frame into out, which must follow the previously decoded
+one unless it is a key frame. Returns false if the data is not a valid frame.
+*/
+const bool Codec::decode(const unsigned char* const data, const std::size_t size, float* const out, ThreadPool* const pool) {
+    const std::size_t nb = bands.size();
+    if(size<sizeof(uint32_t)*(2+nb)) return false;
+    uint32_t head[2];
+    memcpy(head, data, sizeof(head));
+    const bool key = head[0]==1;
+    if(head[1]!=nb || (!key && frame==0)) return false;
+    std::vector<std::size_t> start(nb+1, sizeof(uint32_t)*(2+nb));
+    for(std::size_t b=0 ; b<nb ; b++) {
+        uint32_t band_size;
+        memcpy(&band_size, data + sizeof(uint32_t)*(2+b), sizeof(band_size));
+        start[b+1] = start[b] + band_size;
+    }
+    if(start[nb]>size) return false;
+    std::vector<char> ok(nb);
+    pool->run([&](const int b) { ok[b] = decode_band(b, data + start[b], start[b+1]-start[b], key); }, static_cast<int>(nb));
+    if(std::find(ok.begin(), ok.end(), 0)!=ok.end()) {
+        frame = 0;
+        return false;
+    }
+    std::copy(previous.begin(), previous.end(), out);
+    frame++;
+    return true;
+}
+
+/*
+Decodes band b into the decoded frame. Returns false if the band is broken.
+*/
+const bool Codec::decode_band(const int b, const unsigned char* const data, const std::size_t size, const bool key) {
+    std::size_t offset;
+    std::size_t n;
+    float       lo;
+    float       step;
+    band_range(b, &offset, &n);
+    if(size<2*sizeof(float)) return false;
+    memcpy(&lo, data, sizeof(float));
+    memcpy(&step, data + sizeof(float), sizeof(float));
+    if(step==0) {
+        if(size!=(2+n)*sizeof(float)) return false;
+        memcpy(previous.data() + offset, data + 2*sizeof(float), n*sizeof(float));
+        return true;
+    }
+    std::vector<uint16_t>& sym = symbols[b];
+    sym.resize(n);
+    if(entropy==RICE) {
+        if(!rice_decode(data + 2*sizeof(float), size - 2*sizeof(float), &sym)) return false;
+    }
+    else {
+        #ifdef WITH_ZSTD
+            const std::size_t decoded = ZSTD_decompress(sym.data(), 2*n, data + 2*sizeof(float), size - 2*sizeof(float));
+            if(ZSTD_isError(decoded) || decoded!=2*n) return false;
+        #else
+            return false;
+        #endif
+    }
+    float* const r    = previous.data() + offset;
+    int          pred = key ? 0 : static_cast<int>(lrintf(-lo/step));
+    for(std::size_t i=0 ; i<n ; i++) {
+        const int c = (pred + unzigzag(sym[i])) & 0xFFFF;
+        if(key) {
+            r[i] = dequantize(lo, step, c);
+            pred = c;
+        }
+        else {
+            r[i] += dequantize(lo, step, c);
+        }
+    }
+    return true;
+}
+
+/*
+Codes the values with Rice codes: each block of RICE_BLOCK values shares a
+parameter k, stored on 4 bits, chosen from their mean. A value is coded as
+its quotient by 2^k in unary and its k lowest bits, or as 16 bits after
+ESCAPE ones when the quotient is too large.
+*/
+void Codec::rice_encode(const std::vector<uint16_t>& sym, std::vector<unsigned char>* const out) {
+    BitWriter w(out);
+    for(std::size_t i=0 ; i<sym.size() ; i+=RICE_BLOCK) {
+        const std::size_t end = std::min(sym.size(), i+RICE_BLOCK);
+        uint64_t          sum = 0;
+        for(std::size_t j=i ; j<end ; j++) sum += sym[j];
+        int k = 0;
+        while(k<15 && (static_cast<uint64_t>(end-i) << (k+1))<=sum) k++;
+        w.put(k, 4);
+        for(std::size_t j=i ; j<end ; j++) {
+            const uint32_t q = sym[j] >> k;
+            if(q<ESCAPE) {
+                w.put((1u << q) - 1, q+1);
+                w.put(sym[j] & ((1u << k) - 1), k);
+            }
+            else {
+                w.put((1u << ESCAPE) - 1, ESCAPE);
+                w.put(sym[j], 16);
+            }
+        }
+    }
+    w.flush();
+}
+
+/*
+Decodes the values coded by rice_encode(). Returns false if the data is too short.
+*/
+const bool Codec::rice_decode(const unsigned char* const data, const std::size_t size, std::vector<uint16_t>* const sym) {
+    BitReader r(data, size);
+    for(std::size_t i=0 ; i<sym->size() ; i+=RICE_BLOCK) {
+        const std::size_t end = std::min(sym->size(), i+RICE_BLOCK);
+        const int         k   = static_cast<int>(r.get(4));
+        for(std::size_t j=i ; j<end ; j++) {
+            const int q = __builtin_ctz(~r.peek(ESCAPE) | (1u << ESCAPE));
+            if(q<ESCAPE) {
+                r.skip(q+1);
+                (*sym)[j] = static_cast<uint16_t>((q << k) | r.get(k));
+            }
+            else {
+                r.skip(ESCAPE);
+                (*sym)[j] = static_cast<uint16_t>(r.get(16));
+            }
+        }
+    }
+    return !r.overrun();
+}
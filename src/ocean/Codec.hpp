@@ -0,0 +1,92 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class compresses the frames of a recording with a bounded error. Each channel of a
+frame is cut into bands of TILE_ROWS rows, which are coded independently and concurrently.
+A band is quantized to 16 bits between its minimum and its maximum, with a step of twice
+the maximum error. If 16 bits are not enough for its range, or if the float rounding
+would break the error, the band is stored as raw floats instead. Every KEY_INTERVAL
+frames, a key frame codes the values themselves, each one predicted by the previous one
+of the band. The other frames code the difference with the previous decoded frame, which
+is small as the waves move slowly: the encoder keeps the decoded frame too, so that the
+errors never add up. The quantized values are then coded with adaptive Rice codes, or
+with zstd if the program is built with it.
+A coded frame holds a key flag, the number of bands, the size of every band, and the
+bands, each one starting with its minimum and its quantization step as floats, a zero
+step marking a band of raw floats.
+Decoding a frame needs the previous decoded one, up to the last key frame.
+*/
+
+#ifndef CODECHPP
+#define CODECHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parallel/ThreadPool.hpp"
+
+class Codec {
+
+    public:
+
+        enum ENTROPY {RICE, ZSTD};   /* coding of the quantized values */
+
+        static const int KEY_INTERVAL = 32;   /* nb of frames between two key frames */
+
+        Codec(const int, const int, const int, const double, const ENTROPY);
+        ~Codec() {}
+
+        static const bool has_zstd();
+
+        void       encode(const float* const, std::vector<unsigned char>* const, ThreadPool* const);
+        const bool decode(const unsigned char* const, const std::size_t, float* const, ThreadPool* const);
+
+    private:
+
+        static const int TILE_ROWS  = 32;   /* nb of rows of a band */
+        static const int RICE_BLOCK = 32;   /* nb of values sharing a Rice parameter */
+        static const int ESCAPE     = 24;   /* quotient from which a value is stored as is */
+
+        void       encode_band(const int, const float* const, const bool);
+        const bool decode_band(const int, const unsigned char* const, const std::size_t, const bool);
+        void       band_range(const int, std::size_t* const, std::size_t* const) const;
+
+        static void       rice_encode(const std::vector<uint16_t>&, std::vector<unsigned char>* const);
+        static const bool rice_decode(const unsigned char* const, const std::size_t, std::vector<uint16_t>* const);
+
+        const int                               width;       /* nb of values per row */
+        const int                               height;      /* nb of rows per channel */
+        const int                               nb_channels; /* nb of channels per frame */
+        const int                               nb_tiles;    /* nb of bands per channel */
+        const float                             max_error;   /* maximum absolute error of a value */
+        const ENTROPY                           entropy;     /* coding of the quantized values */
+        long                                    frame;       /* nb of frames coded or decoded so far */
+        std::vector<float>                      previous;    /* previous decoded frame */
+        std::vector<std::vector<unsigned char>> bands;       /* coded bands of the current frame */
+        std::vector<std::vector<uint16_t>>      symbols;     /* quantized values of every band */
+
+};
+
+#endif
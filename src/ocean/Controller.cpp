@@ -0,0 +1,149 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Controller.hpp"
+
+/*
+Initializes the parameters with the ones of the current spectrum.
+*/
+Controller::Controller(Cascade* const p_ocean, const double p_wind_speed, const int p_wind_alignment, const double p_min_wave_size, const double p_A, const double p_fade) :
+    ocean(p_ocean),
+    wind_speed(p_wind_speed),
+    wind_alignment(p_wind_alignment),
+    min_wave_size(p_min_wave_size),
+    A(p_A),
+    fade(p_fade),
+    fd(-1),
+    running(false) {
+}
+
+/*
+Stops the reader and closes the control file.
+*/
+Controller::~Controller() {
+    running = false;
+    if(reader.joinable()) reader.join();
+    if(fd>=0) close(fd);
+}
+
+/*
+Opens the control file, creating a named pipe if it does not exist, and starts
+reading the commands written to it. The pipe is also opened for writing, so
+that it stays open when the programs writing to it exit.
+*/
+void Controller::open(const std::string& file) {
+    struct stat st;
+    if(stat(file.c_str(), &st)!=0 && mkfifo(file.c_str(), 0644)!=0) throw std::runtime_error("cannot create the control pipe " + file);
+    fd = ::open(file.c_str(), O_RDWR | O_NONBLOCK);
+    if(fd<0) throw std::runtime_error("cannot open the control file " + file);
+    running = true;
+    reader  = std::thread(&Controller::read_loop, this);
+}
+
+/*
+Reads the commands of the control file, line by line, until the controller is destroyed.
+*/
+void Controller::read_loop() {
+    std::string line;
+    char        buffer[256];
+    while(running) {
+        struct pollfd p = {fd, POLLIN, 0};
+        if(poll(&p, 1, POLL_PERIOD)<=0) continue;
+        const ssize_t n = read(fd, buffer, sizeof(buffer));
+        if(n<=0) {
+            if(n<0 && errno==EAGAIN) continue;
+            break;
+        }
+        for(ssize_t i=0 ; i<n ; i++) {
+            if(buffer[i]!='\n') {
+                line += buffer[i];
+                continue;
+            }
+            if(!line.empty() && !command(line)) std::cerr << "unknown command: " << line << std::endl;
+            line.clear();
+        }
+    }
+}
+
+/*
+Changes a parameter given by a key. Returns false if the key is not used.
+*/
+const bool Controller::key(const unsigned char k) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        switch(k) {
+            case 'u': wind_speed *= 1.1;                                 break;
+            case 'j': wind_speed /= 1.1;                                 break;
+            case 'i': wind_alignment++;                                  break;
+            case 'k': wind_alignment = std::max(0, wind_alignment-1);    break;
+            case 'o': A *= 1.25;                                         break;
+            case 'l': A /= 1.25;                                         break;
+            case 'p': min_wave_size += 0.05;                             break;
+            case 'm': min_wave_size = std::max(0.0, min_wave_size-0.05); break;
+            default:  return false;
+        }
+    }
+    apply();
+    return true;
+}
+
+/*
+Runs a command, "<name> <value>". Returns false if it is not valid.
+*/
+const bool Controller::command(const std::string& line) {
+    std::istringstream in(line);
+    std::string        name;
+    double             value;
+    if(!(in >> name >> value) || value<0) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(name=="wind_speed" && value>0)  wind_speed     = value;
+        else if(name=="wind_alignment")    wind_alignment = static_cast<int>(value);
+        else if(name=="min_wave_size")     min_wave_size  = value;
+        else if(name=="A")                 A              = value;
+        else if(name=="fade")              fade           = value;
+        else                               return false;
+        if(name=="fade") return true;
+    }
+    apply();
+    return true;
+}
+
+/*
+Asks the ocean for the spectra of the current parameters, and prints them.
+*/
+void Controller::apply() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ocean->regenerate(wind_speed, wind_alignment, min_wave_size, A, fade);
+    std::cout << "wind speed " << wind_speed << ", wind alignment " << wind_alignment << ", min wave size " << min_wave_size << ", A " << A << std::endl;
+}
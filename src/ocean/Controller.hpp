@@ -0,0 +1,76 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class changes the wind and the size of the waves while the ocean runs, from keys
+of the window or from commands written to a control file, usually a named pipe. Every
+change asks the cascade for new spectra, which are computed in the background and faded
+to (see Cascade::regenerate). A command is a line with a name and a value:
+    wind_speed <m/s>, wind_alignment <integer>, min_wave_size <m>, A <value>, fade <s>
+The keys multiply or divide the wind speed and A, and move the wind alignment
+and the minimum wave size by one step:
+    u/j: wind speed, i/k: wind alignment, o/l: A, p/m: minimum wave size
+*/
+
+#ifndef CONTROLLERHPP
+#define CONTROLLERHPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Cascade.hpp"
+
+class Controller {
+
+    public:
+
+        Controller(Cascade* const, const double, const int, const double, const double, const double);
+        ~Controller();
+
+        void       open(const std::string&);
+        const bool key(const unsigned char);
+        const bool command(const std::string&);
+
+    private:
+
+        static const int POLL_PERIOD = 100;   /* time between two checks of the end, in ms */
+
+        void apply();
+        void read_loop();
+
+        Cascade* const    ocean;            /* the controlled ocean */
+        double            wind_speed;       /* current parameters, see Spectrum */
+        int               wind_alignment;
+        double            min_wave_size;
+        double            A;
+        double            fade;             /* duration of the transitions, in seconds */
+        std::mutex        mutex;            /* protects the parameters */
+        int               fd;               /* control file, or -1 */
+        std::thread       reader;           /* reads the commands of the control file */
+        std::atomic<bool> running;          /* false to stop the reader */
+
+};
+
+#endif
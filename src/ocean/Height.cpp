@@ -23,60 +23,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <cmath>
-#include <ctime>
 
 #include "Height.hpp"
 
 /*
 Initializes the variables.
 */
-Height::Height(const int p_nx, const int p_ny) :
-    nx(p_nx),
-    ny(p_ny) {
+Height::Height(const Spectrum& p_spectrum, const int p_ny, const uint32_t p_seed, const uint32_t p_stream) :
+    spectrum(p_spectrum),
+    ny(p_ny),
+    random(p_seed, p_stream) {
 }
 
 /*
-This function initializes the variables to the right values before
-a series of calls to the functor.
+Computes the original spectrum of the column x, which must hold ny+1 values.
+Each wave is the square root of half the spectrum times a complex gaussian number,
+drawn from the stream of the wave so that the columns can be computed in any order.
+The spectrum is first written into re, and the gaussian numbers are drawn by blocks.
 */
-void Height::init_fonctor(const int i) {
-    x = i - nx/2;
-    y = -ny/2;
-}
-
-/*
-Computes the original spectrum. This uses the Philipps spectrum
-and a gaussian number so that the scene is different every time.
-*/
-const double Height::operator()() {
-    y++;
-    return sqrt(philipps[x+(nx/2)][y+(ny/2)]/2) * gaussian();
-}
-
-/*
-Generates the Philips spectrum using the Philipps fonctor.
-*/
-void Height::generate_philipps(Philipps* const p) {
-    philipps.resize(nx+1);
-    for(std::vector<std::vector<double> >::iterator itx=philipps.begin() ; itx!=philipps.end() ; itx++) {
-        itx->resize(ny+1);
-        p->init_fonctor(std::distance(philipps.begin(), itx));
-        std::generate(itx->begin(), itx->end(), *p);
+void Height::generate_column(const int x, double* const re, double* const im) const {
+    double g0[Philox::BLOCK];
+    double g1[Philox::BLOCK];
+    spectrum.evaluate(x, re);
+    for(int b=0 ; b<=ny ; b+=Philox::BLOCK) {
+        const int n = std::min(Philox::BLOCK, ny+1-b);
+        random.gaussians(x, b, n, g0, g1);
+        for(int i=0 ; i<n ; i++) {
+            const double a = sqrt(re[b+i]/2);
+            re[b+i] = a*g0[i];
+            im[b+i] = a*g1[i];
+        }
     }
 }
-
-/*
-Gaussian random generator. The numbers are generated
-using the Box-Muller method.
-*/
-const double Height::gaussian() {
-    double var1;
-    double var2;
-    double s;
-    do {
-        var1 = (rand() % 201 - 100)/static_cast<double>(100);
-        var2 = (rand() % 201 - 100)/static_cast<double>(100);
-        s    = var1*var1 + var2*var2;
-    } while(s>=1 || s==0);
-    return var1*sqrt(-log(s)/s);
-}
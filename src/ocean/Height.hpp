@@ -23,42 +23,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /*
 This class computes the initial spectrum for the scene. Using random gaussian
-numbers, it makes sure the ocean is different everytime the software is run.
-This class needs the Philipps spectrum to run, and defines a fonctor to be used
-with std::generate algorithm.
+numbers, it makes sure the ocean is different for every seed. The numbers come
+from a counter-based generator, keyed by the seed and the stream, so that the
+same seed always gives the same ocean, and the columns can be computed in parallel.
+This class needs a spectrum to run, which is evaluated one column at a time right
+into the initial height field, without any intermediate table.
 */
 
 #ifndef HEIGHTHPP
 #define HEIGHTHPP
 
-#include <iostream>
-#include <vector>
+#include <cstdint>
 
-#include "Philipps.hpp"
+#include "Philox.hpp"
+#include "Spectrum.hpp"
 
 class Height {
     
     public:
-
-        static const double gaussian();
     
-        Height(const int, const int);
+        Height(const Spectrum&, const int, const uint32_t, const uint32_t);
         ~Height() {}
     
-        const double operator()();
-    
-        void init_fonctor(const int);
-        void generate_philipps(Philipps* const);
+        void generate_column(const int, double* const, double* const) const;
      
     private:
     
-        typedef std::vector<std::vector<double>> vec_vec_d;
-    
-        const int nx;        /* nb of x points - must be a power of 2 */
-        const int ny;        /* nb of y points - must be a power of 2 */
-        vec_vec_d philipps;  /* Philips spectrum _philipps[y][x] */
-        int       x;
-        int       y;
+        const Spectrum& spectrum;  /* spectrum of the waves */
+        const int       ny;        /* nb of y points - must be a power of 2 */
+        const Philox    random;    /* gaussian numbers of each wave */
     
 };
 
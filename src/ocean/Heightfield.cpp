@@ -0,0 +1,170 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Heightfield.hpp"
+
+/*
+Makes this frame the surface at time t, between the frames a and b. The
+horizontal coordinates and the normals are interpolated linearly. The heights use cubic
+Hermite polynomials when both frames have their time derivatives, which
+follows the motion of the waves much better than a straight line between
+two frames far apart in time. Outside [a.time ; b.time], the closest
+frame is used.
+*/
+void Heightfield::interpolate(const Heightfield& a, const Heightfield& b, const double t) {
+    nx   = b.nx;
+    ny   = b.ny;
+    time = t;
+    vertices.resize(b.vertices.size());
+    rates.clear();
+    if(a.vertices.size()!=b.vertices.size() || b.time<=a.time) {
+        std::copy(b.vertices.begin(), b.vertices.end(), vertices.begin());
+        return;
+    }
+    const double dt = b.time - a.time;
+    const double s  = std::min(1.0, std::max(0.0, (t-a.time)/dt));
+    const int    nb = (nx+1)*(ny+1);
+    const float  f  = static_cast<float>(s);
+    for(int i=0 ; i<STRIDE*nb ; i++) vertices[i] = a.vertices[i] + f*(b.vertices[i]-a.vertices[i]);
+    if(!a.rates.empty() && !b.rates.empty()) {
+        const double h00 = (1+2*s)*(1-s)*(1-s);
+        const double h10 = s*(1-s)*(1-s)*dt;
+        const double h01 = s*s*(3-2*s);
+        const double h11 = s*s*(s-1)*dt;
+        for(int i=0 ; i<nb ; i++) {
+            vertices[STRIDE*i+1] = h00*a.vertices[STRIDE*i+1] + h10*a.rates[i] + h01*b.vertices[STRIDE*i+1] + h11*b.rates[i];
+        }
+    }
+}
+
+/*
+Returns the nb of floats per vertex of the given channels.
+*/
+const int Heightfield::nb_floats(const int channels) {
+    return 1 + (channels & DISPLACEMENTS ? 2 : 0) + (channels & NORMALS ? 3 : 0);
+}
+
+/*
+Computes the normals of the row y of vertices, for y in [0 ; ny], from the
+positions of their neighbours, the ocean being periodic: the row y needs
+the rows around it, so the frame can be filled and its normals computed in
+one pass, with one row of delay. lx and ly are the actual size of the ocean.
+When the surface is not periodic, the border vertices use their only inner
+neighbour instead, and lx and ly are not used.
+The interior of the row is computed apart from its ends, without any
+wrapping, by blocks of NORMAL_BLOCK vertices: their tangents are first copied
+out of the interleaved rows into planar arrays, the normals are computed there,
+and copied back. The normals are written into the rows they are computed from,
+so without these arrays the compiler could not vectorize the loops.
+*/
+void Heightfield::compute_normals(const int y, const double lx, const double ly, const bool periodic) {
+    const int          yd = y>0  ? y-1 : (periodic ? ny-1 : 0);
+    const int          yu = y<ny ? y+1 : (periodic ? 1 : ny);
+    const float        sz = periodic ? (y>0 ? 0 : ly) + (y<ny ? 0 : ly) : 0;
+    const float* const d  = row(yd);
+    const float* const u  = row(yu);
+    float* const       v  = row(y);
+    const auto normal = [&](const int x, const int xl, const int xr, const float sx) {
+        const float* const l    = v + STRIDE*xl;
+        const float* const r    = v + STRIDE*xr;
+        const float        tx0  = r[0]-l[0]+sx;
+        const float        tx1  = r[1]-l[1];
+        const float        tx2  = r[2]-l[2];
+        const float        tz0  = u[STRIDE*x]   - d[STRIDE*x];
+        const float        tz1  = u[STRIDE*x+1] - d[STRIDE*x+1];
+        const float        tz2  = u[STRIDE*x+2] - d[STRIDE*x+2] + sz;
+        const float        n0   = tz1*tx2 - tz2*tx1;
+        const float        n1   = tz2*tx0 - tz0*tx2;
+        const float        n2   = tz0*tx1 - tz1*tx0;
+        const float        norm = 1/sqrtf(n0*n0 + n1*n1 + n2*n2);
+        float* const       out  = v + STRIDE*x + 3;
+        out[0] = n0*norm;
+        out[1] = n1*norm;
+        out[2] = n2*norm;
+    };
+    if(periodic) normal(0, nx-1, 1, lx);
+    else         normal(0, 0, 1, 0);
+    for(int x0=1 ; x0<nx ; x0+=NORMAL_BLOCK) {
+        const int          m = std::min(NORMAL_BLOCK, nx-x0);
+        const float* const l = v + STRIDE*(x0-1);
+        const float* const r = v + STRIDE*(x0+1);
+        const float* const a = d + STRIDE*x0;
+        const float* const b = u + STRIDE*x0;
+        float* const       o = v + STRIDE*x0 + 3;
+        float              tx[3][NORMAL_BLOCK];
+        float              tz[3][NORMAL_BLOCK];
+        float              n[3][NORMAL_BLOCK];
+        for(int c=0 ; c<3 ; c++) {
+            for(int j=0 ; j<m ; j++) tx[c][j] = r[STRIDE*j+c] - l[STRIDE*j+c];
+            for(int j=0 ; j<m ; j++) tz[c][j] = b[STRIDE*j+c] - a[STRIDE*j+c];
+        }
+        for(int j=0 ; j<m ; j++) tz[2][j] += sz;
+        for(int j=0 ; j<m ; j++) {
+            const float n0   = tz[1][j]*tx[2][j] - tz[2][j]*tx[1][j];
+            const float n1   = tz[2][j]*tx[0][j] - tz[0][j]*tx[2][j];
+            const float n2   = tz[0][j]*tx[1][j] - tz[1][j]*tx[0][j];
+            const float norm = 1/sqrtf(n0*n0 + n1*n1 + n2*n2);
+            n[0][j] = n0*norm;
+            n[1][j] = n1*norm;
+            n[2][j] = n2*norm;
+        }
+        for(int c=0 ; c<3 ; c++) {
+            for(int j=0 ; j<m ; j++) o[STRIDE*j+c] = n[c][j];
+        }
+    }
+    if(periodic) normal(nx, nx-1, 1, lx);
+    else         normal(nx, nx-1, nx, 0);
+}
+
+/*
+Converts the frame to planes of floats: the heights, then the horizontal
+displacements along x and z, then the three coordinates of the normals,
+as asked by the channels. lx and ly are the actual size of the ocean.
+*/
+void Heightfield::pack(const double lx, const double ly, const int channels, float* const out) const {
+    const std::size_t nb = static_cast<std::size_t>(nx+1)*(ny+1);
+    const double      dx = lx/nx;
+    const double      dz = ly/ny;
+    const float*      v  = vertices.data();
+    float*            c  = out;
+    for(std::size_t i=0 ; i<nb ; i++) c[i] = v[STRIDE*i+1];
+    c += nb;
+    if(channels & DISPLACEMENTS) {
+        for(int y=0 ; y<=ny ; y++) {
+            for(int x=0 ; x<=nx ; x++) {
+                const int i = (nx+1)*y + x;
+                c[i]      = static_cast<float>(v[STRIDE*i]   - dx*x);
+                c[nb + i] = static_cast<float>(v[STRIDE*i+2] - dz*y);
+            }
+        }
+        c += 2*nb;
+    }
+    if(channels & NORMALS) {
+        for(std::size_t i=0 ; i<nb ; i++) {
+            for(int j=0 ; j<3 ; j++) c[j*nb + i] = v[STRIDE*i + 3 + j];
+        }
+    }
+}
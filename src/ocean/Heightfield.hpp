@@ -0,0 +1,67 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This structure holds one frame of the ocean surface, ready for the rendering.
+The grid has (nx+1)*(ny+1) vertices so that the last row and column close the
+ocean. Each vertex has three float coordinates, the height being the second one,
+followed by its normal, and the vertices are stored row after row, so that the
+buffer can be given as it is to the graphics card:
+vertices[STRIDE*((nx+1)*y + x) + i], the normal being at i = 3, 4 and 5.
+The time derivative of the heights can be stored too, so that a frame can be
+interpolated between two others with cubic Hermite polynomials.
+A frame can be converted to planes of floats for the other processes.
+*/
+
+#ifndef HEIGHTFIELDHPP
+#define HEIGHTFIELDHPP
+
+#include <vector>
+
+struct Heightfield {
+
+    enum CHANNEL {HEIGHTS=1, DISPLACEMENTS=2, NORMALS=4};   /* planes given by pack(), as bits */
+
+    static const int STRIDE       = 6;    /* nb of floats per vertex: position, then normal */
+    static const int NORMAL_BLOCK = 64;   /* nb of normals computed together */
+
+    int                nx;          /* nb of x subdivisions */
+    int                ny;          /* nb of y subdivisions */
+    double             time;        /* simulation time of the frame, in seconds */
+    std::vector<float> vertices;    /* (nx+1)*(ny+1) vertices, row after row */
+    std::vector<float> rates;       /* time derivative of the heights, or empty */
+
+    Heightfield() : nx(0), ny(0), time(0) {}
+
+    void interpolate(const Heightfield&, const Heightfield&, const double);
+    void compute_normals(const int, const double, const double, const bool=true);
+    void pack(const double, const double, const int, float* const) const;
+
+    static const int nb_floats(const int);
+
+    float*       row(const int y)       { return &vertices[STRIDE*(nx+1)*y]; }
+    const float* row(const int y) const { return &vertices[STRIDE*(nx+1)*y]; }
+
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Cascade.hpp"
+#include "Host.hpp"
+
+/*
+Creates the pool with the given nb of threads. The plans are built when asked.
+*/
+Host::Host(const int nb_threads) :
+    pool(nb_threads) {
+}
+
+/*
+Frees the plans. The cascades created on this host must be deleted before.
+*/
+Host::~Host() {
+    for(std::map<int, FFTPlan*>::iterator it=plans.begin() ; it!=plans.end() ; it++) delete it->second;
+}
+
+/*
+Returns the plan of the FFTs of size n, built at the first call.
+*/
+const FFTPlan* Host::get_plan(const int n) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FFTPlan*& plan = plans[n];
+    if(!plan) plan = new FFTPlan(n);
+    return plan;
+}
+
+/*
+Returns the nb of bytes held by the plans.
+*/
+const std::size_t Host::get_memory() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t bytes = 0;
+    for(std::map<int, FFTPlan*>::const_iterator it=plans.begin() ; it!=plans.end() ; it++) bytes += it->second->get_size();
+    return bytes;
+}
+
+/*
+Computes all the cascades of the given oceans at time t. The cascades of every
+ocean are the tasks of a single series, so that no thread waits for an ocean
+to be done before starting the next one.
+*/
+void Host::main_computation(const std::vector<Cascade*>& oceans, const double t) {
+    std::vector<Ocean*> tasks;
+    for(std::size_t i=0 ; i<oceans.size() ; i++) {
+        oceans[i]->start_fade();
+        for(int j=0 ; j<oceans[i]->get_nb_cascades() ; j++) tasks.push_back(oceans[i]->get_ocean(j));
+    }
+    pool.run([&tasks, t](const int i) { tasks[i]->main_computation(t); }, static_cast<int>(tasks.size()));
+}
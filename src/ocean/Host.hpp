@@ -0,0 +1,66 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class holds what all the oceans of a process share: the thread pool computing
+them, and the FFT plans, one per size, with their bit-reversal and twiddle tables.
+Any number of cascades can be created on the same host, with different seeds and
+sea states, for a server to simulate many regions without duplicating the tables.
+main_computation() computes several of them for the same time in a single series
+of tasks, so that the threads stay busy whatever the number of cascades of each.
+*/
+
+#ifndef HOSTHPP
+#define HOSTHPP
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "fft/FFTPlan.hpp"
+#include "parallel/ThreadPool.hpp"
+
+class Cascade;
+
+class Host {
+
+    public:
+
+        Host(const int);
+        ~Host();
+
+        ThreadPool* get_pool() { return &pool; }
+
+        const FFTPlan*    get_plan(const int);
+        const std::size_t get_memory();
+        void main_computation(const std::vector<Cascade*>&, const double);
+
+    private:
+
+        ThreadPool               pool;    /* threads shared by all the oceans */
+        std::mutex               mutex;   /* protects the plans */
+        std::map<int, FFTPlan*>  plans;   /* plans by size, built on demand */
+
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "parallel/ThreadPool.hpp"
+#include "LoopCache.hpp"
+
+/*
+Initializes the variables. Nothing is computed before build() is called. The key
+must change with every parameter the waves depend on.
+*/
+LoopCache::LoopCache(Cascade* const p_ocean, const double p_period, const int p_nb_frames, const uint64_t p_key) :
+    ocean(p_ocean),
+    period(p_period),
+    nb_frames(p_nb_frames),
+    key(p_key),
+    nx(p_ocean->get_frame_nx()),
+    ny(p_ocean->get_frame_ny()),
+    choppy(p_ocean->get_ocean(0)->get_choppiness()!=0),
+    with_rates(p_ocean->get_ocean(0)->has_velocity()),
+    channels(1 + (choppy ? 2 : 0) + (with_rates ? 1 : 0)),
+    frame_size(static_cast<std::size_t>(channels)*(nx+1)*(ny+1)),
+    frames(nullptr),
+    mapping(nullptr),
+    mapping_size(0),
+    reused(false) {
+}
+
+/*
+Unmaps the file if any.
+*/
+LoopCache::~LoopCache() {
+    if(mapping) munmap(mapping, mapping_size);
+}
+
+/*
+Returns the header describing this cache.
+*/
+const LoopCache::header LoopCache::make_header() const {
+    header h;
+    memset(&h, 0, sizeof(h));
+    strcpy(h.magic, "FFTLOOP");
+    h.version   = 3;
+    h.nx        = nx;
+    h.ny        = ny;
+    h.nb_frames = nb_frames;
+    h.channels  = channels;
+    h.period    = period;
+    h.key       = key;
+    return h;
+}
+
+/*
+Maps the given file in memory, creating it if it does not exist or if it does not
+match this cache. Returns true if the file already contained the frames.
+*/
+const bool LoopCache::map_file(const std::string& file) {
+    const header h = make_header();
+    mapping_size   = sizeof(header) + sizeof(float)*frame_size*nb_frames;
+    int          fd = open(file.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat  st;
+    header       found;
+    if(fd<0 || fstat(fd, &st)!=0) throw std::runtime_error("cannot open the loop cache file " + file);
+    const bool matches = static_cast<std::size_t>(st.st_size)==mapping_size && read(fd, &found, sizeof(found))==static_cast<ssize_t>(sizeof(found)) && memcmp(&found, &h, sizeof(h))==0;
+    if(!matches && ftruncate(fd, mapping_size)!=0) {
+        close(fd);
+        throw std::runtime_error("cannot resize the loop cache file " + file);
+    }
+    mapping = mmap(nullptr, mapping_size, matches ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping==MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("cannot map the loop cache file " + file);
+    }
+    frames = reinterpret_cast<float*>(static_cast<char*>(mapping) + sizeof(header));
+    if(!matches) memcpy(mapping, &h, sizeof(h));
+    return matches;
+}
+
+/*
+Computes all the frames of the period, or maps them from the file if it was
+built before with the same parameters. Without file, the frames are kept in
+memory. The frames are shared among clones of the ocean, one per thread.
+*/
+void LoopCache::build(const std::string& file) {
+    if(file.empty()) {
+        memory.resize(frame_size*nb_frames);
+        frames = memory.data();
+    }
+    else if(map_file(file)) {
+        reused = true;
+        return;
+    }
+    const int                nb_threads = std::max(1, std::min(nb_frames, static_cast<int>(std::thread::hardware_concurrency())));
+    std::vector<Cascade*>    clones(nb_threads, ocean);
+    std::vector<Heightfield> scratch(nb_threads);
+    ThreadPool               pool(nb_threads);
+    for(int i=1 ; i<nb_threads ; i++) clones[i] = ocean->clone();
+    pool.run([&](const int i) {
+        for(int j=i ; j<nb_frames ; j+=nb_threads) compute(j, clones[i], &scratch[i]);
+    }, nb_threads);
+    for(int i=1 ; i<nb_threads ; i++) delete clones[i];
+    if(mapping) msync(mapping, mapping_size, MS_ASYNC);
+}
+
+/*
+Computes the frame j with the given ocean and stores its varying values.
+*/
+void LoopCache::compute(const int j, Cascade* const o, Heightfield* const frame) {
+    const double t   = j*period/nb_frames;
+    float* const dst = frames + frame_size*j;
+    o->main_computation(t);
+    o->fill_heightfield(t, frame);
+    for(int y=0 ; y<=ny ; y++) {
+        for(int x=0 ; x<=nx ; x++) {
+            const int          v    = (nx+1)*y + x;
+            const float* const src  = &frame->vertices[Heightfield::STRIDE*v];
+            float* const       out  = dst + channels*v;
+            int                c    = 0;
+            out[c++] = src[1];
+            if(choppy) {
+                out[c++] = src[0] - (ocean->get_lx()/nx)*x;
+                out[c++] = src[2] - (ocean->get_ly()/ny)*y;
+            }
+            if(with_rates) out[c++] = frame->rates[v];
+        }
+    }
+}
+
+/*
+Fills the frame with the cached frame for time t, which is the latest frame
+before t. The time of the frame is not wrapped, so that it keeps increasing.
+The normals are computed as in Cascade::fill_heightfield(), in the same pass.
+*/
+void LoopCache::fill_heightfield(const double t, Heightfield* const frame) const {
+    const long         n   = static_cast<long>(floor(t*get_rate()));
+    const int          j   = static_cast<int>(((n%nb_frames)+nb_frames)%nb_frames);
+    const float* const src = frames + frame_size*j;
+    const double       dx  = ocean->get_lx()/nx;
+    const double       dy  = ocean->get_ly()/ny;
+    frame->nx   = nx;
+    frame->ny   = ny;
+    frame->time = n/get_rate();
+    frame->vertices.resize(Heightfield::STRIDE*(nx+1)*(ny+1));
+    if(with_rates) frame->rates.resize((nx+1)*(ny+1));
+    else           frame->rates.clear();
+    for(int y=0 ; y<=ny ; y++) {
+        for(int x=0 ; x<=nx ; x++) {
+            const int          v   = (nx+1)*y + x;
+            const float* const in  = src + channels*v;
+            float* const       out = &frame->vertices[Heightfield::STRIDE*v];
+            int                c   = 0;
+            out[1] = in[c++];
+            out[0] = dx*x;
+            out[2] = dy*y;
+            if(choppy) {
+                out[0] += in[c++];
+                out[2] += in[c++];
+            }
+            if(with_rates) frame->rates[v] = in[c++];
+        }
+        if(y>=2) frame->compute_normals(y-1, ocean->get_lx(), ocean->get_ly());
+    }
+    frame->compute_normals(0, ocean->get_lx(), ocean->get_ly());
+    frame->compute_normals(ny, ocean->get_lx(), ocean->get_ly());
+}
@@ -0,0 +1,97 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class precomputes one period of a periodic ocean, so that it can be played in a
+loop without computing any FFT. The dispersion of the ocean has to be quantized with
+the same period first. The frames are computed once, in parallel by several clones of
+the ocean, and stored as floats with only the varying values of each vertex: the
+height, the horizontal displacement if the ocean is choppy, and the time derivative
+of the height if it is computed. The cache is kept in memory, or in a file which is
+memory-mapped. Such a file is reused by the next runs if it matches the parameters:
+its header holds the size of the frames and a key, the hash of the parameters the
+waves depend on, given by the caller.
+*/
+
+#ifndef LOOPCACHEHPP
+#define LOOPCACHEHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Cascade.hpp"
+#include "Heightfield.hpp"
+
+class LoopCache {
+
+    public:
+
+        LoopCache(Cascade* const, const double, const int, const uint64_t);
+        ~LoopCache();
+
+        const double      get_period() const { return period; }
+        const double      get_rate()   const { return nb_frames/period; }
+        const std::size_t get_size()   const { return sizeof(float)*frame_size*nb_frames; }
+        const bool        is_reused()  const { return reused; }
+
+        void build(const std::string&);
+        void fill_heightfield(const double, Heightfield* const) const;
+
+    private:
+
+        struct header {
+            char     magic[8];     /* "FFTLOOP" */
+            unsigned version;      /* version of the file format */
+            unsigned nx;           /* nb of x subdivisions */
+            unsigned ny;           /* nb of y subdivisions */
+            unsigned nb_frames;    /* nb of frames in the period */
+            unsigned channels;     /* nb of floats per vertex */
+            double   period;       /* period of the ocean, in seconds */
+            uint64_t key;          /* hash of the parameters */
+        };
+
+        void         compute(const int, Cascade* const, Heightfield* const);
+        const header make_header() const;
+        const bool   map_file(const std::string&);
+
+        Cascade* const     ocean;        /* ocean to precompute */
+        const double       period;       /* period of the ocean, in seconds */
+        const int          nb_frames;    /* nb of frames in the period */
+        const uint64_t     key;          /* hash of the parameters */
+        const int          nx;           /* nb of x subdivisions */
+        const int          ny;           /* nb of y subdivisions */
+        const bool         choppy;       /* true if the horizontal displacement is stored */
+        const bool         with_rates;   /* true if the time derivative of the heights is stored */
+        const int          channels;     /* nb of floats per vertex */
+        const std::size_t  frame_size;   /* nb of floats per frame */
+        std::vector<float> memory;       /* the frames, when kept in memory */
+        float*             frames;       /* the frames, in memory or in the mapped file */
+        void*              mapping;      /* mapped file, or nullptr */
+        std::size_t        mapping_size; /* size of the mapped file */
+        bool               reused;       /* true if the frames come from an existing file */
+
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This structure describes one wave of the spectrum, with its opposite wave. The
+spectrum being hermitian, the waves k and -k always come together and their sum
+is real: H(k, t).e^(ik.x) + H(-k, t).e^(-ik.x) = 2.Re(H(k, t).e^(ik.x)), with
+H(k, t) = h0(k).e^(i.omega.t) + conj(h0(-k)).e^(-i.omega.t).
+*/
+
+#ifndef MODEHPP
+#define MODEHPP
+
+struct Mode {
+
+    int    x;        /* index of k along x in the shifted transforms, k=0 being at 0 */
+    int    y;        /* index of k along y in the shifted transforms */
+    double kx;       /* wave vector along x */
+    double ky;       /* wave vector along y (z axis of the scene) */
+    double omega;    /* angular frequency, per second of actual time */
+    double h0R;      /* h0(k), real part */
+    double h0I;      /* h0(k), imaginary part */
+    double h0mR;     /* h0(-k), real part */
+    double h0mI;     /* h0(-k), imaginary part */
+    double energy;   /* |h0(k)|^2 + |h0(-k)|^2 */
+
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Noise.hpp"
+
+const double Noise::G       = 9.81;
+const float  Noise::STRETCH = 3;
+
+/*
+Initializes the octaves, the first one having the given wavelength, the wind
+blowing along (p_ux, p_uz). A lattice cell is half a wavelength long along the
+wind. The RMS height of the noise is measured once on a grid of points spread
+over many cells, so that heights() gives a unit RMS height.
+*/
+Noise::Noise(const double wavelength, const double p_ux, const double p_uz, const uint32_t p_seed) :
+    seed(p_seed),
+    scale(1) {
+    const double norm = sqrt(p_ux*p_ux + p_uz*p_uz);
+    const int    n    = 64;
+    ux = norm>0 ? p_ux/norm : 1;
+    uz = norm>0 ? p_uz/norm : 0;
+    for(int i=0 ; i<OCTAVES ; i++) {
+        const double l = wavelength/(1<<i);
+        frequency[i] = 2/l;
+        amplitude[i] = 1.0/(1<<i);
+        speed[i]     = sqrt(G*l/(2*M_PI));
+    }
+    std::vector<float> xs(n*n);
+    std::vector<float> zs(n*n);
+    std::vector<float> h(n*n);
+    for(int i=0 ; i<n*n ; i++) {
+        xs[i] = 0.37*wavelength*(i%n);
+        zs[i] = 0.37*wavelength*(i/n);
+    }
+    heights(xs.data(), zs.data(), h.data(), n*n, 0);
+    double sum = 0;
+    for(int i=0 ; i<n*n ; i++) sum += h[i]*h[i];
+    scale = sum>0 ? 1/sqrt(sum/(n*n)) : 1;
+}
+
+/*
+Computes the height of the noise at n actual positions (xs[i], zs[i]) at time t,
+in seconds. The positions are processed by blocks, so that they stay in the cache
+while the octaves are added.
+*/
+void Noise::heights(const float* const xs, const float* const zs, float* const out, const std::size_t n, const double t) const {
+    for(std::size_t i=0 ; i<n ; i+=BLOCK) {
+        const int m = static_cast<int>(std::min<std::size_t>(BLOCK, n-i));
+        std::fill(out+i, out+i+m, 0.0f);
+        for(int k=0 ; k<OCTAVES ; k++) octave(k, xs+i, zs+i, out+i, m, t);
+        for(int j=0 ; j<m ; j++) out[i+j] *= scale;
+    }
+}
+
+/*
+Adds the octave k of the noise at m positions. The positions are moved to the
+lattice of the octave, along and across the wind, and the four corners of their
+cell get pseudo-random gradients from a hash of their coordinates. The lattice
+repeats every 65536 cells, so that the drift can be wrapped and keeps the float
+precision however long the ocean runs. The floors are computed with integer
+conversions, which vectorize on any SSE2 processor.
+*/
+void Noise::octave(const int k, const float* const xs, const float* const zs, float* const out, const int m, const double t) const {
+    const float    f     = frequency[k];
+    const float    g     = frequency[k]/STRETCH;
+    const float    a     = amplitude[k];
+    const float    drift = static_cast<float>(fmod(speed[k]*f*t, 65536.0));
+    const uint32_t s     = seed + 0x9E3779B9u*static_cast<uint32_t>(k+1);
+    for(int j=0 ; j<m ; j++) {
+        const float    p   = (ux*xs[j] + uz*zs[j])*f - drift;
+        const float    q   = (ux*zs[j] - uz*xs[j])*g;
+        const int      ip  = static_cast<int>(p) - (p<static_cast<int>(p));
+        const int      iq  = static_cast<int>(q) - (q<static_cast<int>(q));
+        const float    fp  = p - ip;
+        const float    fq  = q - iq;
+        const uint32_t hp0 = static_cast<uint32_t>(ip & 0xFFFF)*0x8DA6B343u;
+        const uint32_t hp1 = static_cast<uint32_t>((ip+1) & 0xFFFF)*0x8DA6B343u;
+        const uint32_t hq0 = (static_cast<uint32_t>(iq & 0xFFFF)*0xD8163841u) ^ s;
+        const uint32_t hq1 = (static_cast<uint32_t>((iq+1) & 0xFFFF)*0xD8163841u) ^ s;
+        const float    n00 = gradient(hp0^hq0, fp,   fq);
+        const float    n10 = gradient(hp1^hq0, fp-1, fq);
+        const float    n01 = gradient(hp0^hq1, fp,   fq-1);
+        const float    n11 = gradient(hp1^hq1, fp-1, fq-1);
+        const float    up  = fp*fp*fp*(fp*(fp*6-15)+10);
+        const float    uq  = fq*fq*fq*(fq*(fq*6-15)+10);
+        const float    n0  = n00 + up*(n10-n00);
+        const float    n1  = n01 + up*(n11-n01);
+        out[j] += a*(n0 + uq*(n1-n0));
+    }
+}
+
+/*
+Returns the dot product of (x, y) with the gradient of a corner of the lattice,
+whose two coordinates in [-1 ; 1] are taken from the mixed bits of its hash h.
+*/
+inline const float Noise::gradient(uint32_t h, const float x, const float y) {
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    const float gx = static_cast<int>(h & 0xFFFF)*(2.0f/65535) - 1;
+    const float gy = static_cast<int>(h >> 16)*(2.0f/65535) - 1;
+    return gx*x + gy*y;
+}
@@ -0,0 +1,71 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class makes waves out of gradient noise (Perlin noise), which cost much less
+than an FFT and never repeat, for the far field of an infinite ocean. The noise is
+a sum of octaves of halving wavelengths and amplitudes. Each octave is stretched
+across the wind, like the crests of the waves, and drifts along the wind at the phase
+speed of deep water waves of its wavelength. The gradients of the lattice come from
+an integer hash of the corners and of the seed, without any table, so that the
+heights are computed by blocks in loops that the compiler can vectorize. The noise
+is scaled to a unit RMS height when it is created.
+*/
+
+#ifndef NOISEHPP
+#define NOISEHPP
+
+#include <cstddef>
+#include <cstdint>
+
+class Noise {
+
+    public:
+
+        Noise(const double, const double, const double, const uint32_t);
+        ~Noise() {}
+
+        void heights(const float* const, const float* const, float* const, const std::size_t, const double) const;
+
+    private:
+
+        static const double G;                  /* gravity */
+        static const int    OCTAVES = 4;        /* nb of octaves summed */
+        static const int    BLOCK   = 64;       /* nb of positions computed together */
+        static const float  STRETCH;            /* length of the crests over the wavelength */
+
+        void octave(const int, const float* const, const float* const, float* const, const int, const double) const;
+
+        static inline const float gradient(uint32_t, const float, const float);
+
+        float    ux;                            /* direction of the wind along x */
+        float    uz;                            /* direction of the wind along z */
+        uint32_t seed;                          /* seed of the hash of the lattice */
+        float    frequency[OCTAVES];            /* nb of lattice cells per meter along the wind */
+        float    amplitude[OCTAVES];            /* amplitude of each octave */
+        float    speed[OCTAVES];                /* drift of each octave along the wind, in meters per second */
+        float    scale;                         /* 1 over the RMS height of the sum of the octaves */
+
+};
+
+#endif
@@ -25,34 +25,86 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cmath>
 #include <iostream>
 
-#include "cross_platform/GLUT.hpp"
-
 #include "Height.hpp"
+#include "Heightfield.hpp"
 #include "Ocean.hpp"
 
+const double Ocean::G               = 9.81;
+const double Ocean::SURFACE_TENSION = 0.074/1000;
+
 /*
-Initializes the variables and allocates space for the vectors.
+Initializes the variables and allocates space for the vectors. The displacement
+and jacobian vectors are only allocated when the choppiness is not zero, and so
+is the velocity vector, which otherwise shares the height transform. Each grid
+holds its spectrum and then its signal, so there is no separate time-domain copy.
+The spectrum is stored shifted, with k=0 at the index 0, so that the grids only
+need nx*ny values and the signal needs no sign correction.
+The spectrum stays flat until generate_height() is called. The dispersion
+table uses the relation of gravity waves with surface tension in water
+of finite depth: omega^2 = (g.k + sigma/rho.k^3).tanh(k.depth).
+The FFTs on rows and on columns use the given plans, of sizes nx and ny.
 */
-Ocean::Ocean(const double p_lx, const double p_ly, const int p_nx, const int p_ny, const double p_motion_factor) :
+Ocean::Ocean(const double p_lx, const double p_ly, const int p_nx, const int p_ny, const double p_motion_factor, const double p_choppiness, const double p_foam_threshold, const double p_foam_decay, const bool p_with_velocity, const double p_mode_cutoff, const double p_depth, const FFTPlan* const p_plan_x, const FFTPlan* const p_plan_y) :
     lx(p_lx),
     ly(p_ly),
     nx(p_nx),
     ny(p_ny),
-    motion_factor(p_motion_factor) {
+    motion_factor(p_motion_factor),
+    choppiness(p_choppiness),
+    foam_threshold(p_foam_threshold),
+    foam_decay(p_foam_decay),
+    depth(p_depth),
+    foam_time(0),
+    with_velocity(p_with_velocity),
+    velocity(&hi),
+    mode_cutoff(p_mode_cutoff),
+    energy_fraction(1),
+    fade_started(false),
+    fade_start(0),
+    fade_duration(0),
+    fade_progress(0) {
+    for(int i=0 ; i<NB_STAGES ; i++) stage_time[i] = 0;
+    surface_h.assign(nx*ny, 0);
+    if(choppiness!=0) {
+        surface_dx.assign(nx*ny, 0);
+        surface_dz.assign(nx*ny, 0);
+    }
     height0I.resize(nx+1);
     height0R.resize(nx+1);
-    HR.resize(nx+1);
-    HI.resize(nx+1);
-    hr.resize(ny+1);
-    hi.resize(ny+1);
-    for(vec_vec_d_it it=HR.begin() ; it!=HR.end() ; it++) it->resize(ny+1);
-    for(vec_vec_d_it it=HI.begin() ; it!=HI.end() ; it++) it->resize(ny+1);
-    for(vec_vec_d_it it=hr.begin() ; it!=hr.end() ; it++) it->resize(nx+1);
-    for(vec_vec_d_it it=hi.begin() ; it!=hi.end() ; it++) it->resize(nx+1);
-    ffty.reserve(nx);
+    hr.resize(ny);
+    hi.resize(ny);
+    for(vec_vec_d_it it=hr.begin() ; it!=hr.end() ; it++) it->resize(nx);
+    for(vec_vec_d_it it=hi.begin() ; it!=hi.end() ; it++) it->resize(nx);
+    column_r.resize(ny);
+    column_i.resize(ny);
+    fft_column = new FFT(p_plan_y, &column_r, &column_i);
     fftx.reserve(ny);
-    for(int i=0 ; i<nx ; i++) ffty.push_back(new FFT(ny, &HR[i], &HI[i]));
-    for(int i=0 ; i<ny ; i++) fftx.push_back(new FFT(nx, &hr[i], &hi[i]));
+    for(int i=0 ; i<ny ; i++) fftx.push_back(new FFT(p_plan_x, &hr[i], &hi[i]));
+    omega.assign(nx+1, std::vector<double>(ny+1));
+    for(int x=0 ; x<=nx ; x++) {
+        const double kx = (2*M_PI*(x-nx/2))/lx;
+        for(int y=0 ; y<=ny ; y++) {
+            const double ky = (2*M_PI*(y-ny/2))/ly;
+            const double k  = sqrt(kx*kx + ky*ky);
+            omega[x][y] = sqrt((G*k + SURFACE_TENSION*k*k*k) * tanh(k*depth));
+        }
+    }
+    if(choppiness!=0) {
+        dr.assign(ny, std::vector<double>(nx));
+        di.assign(ny, std::vector<double>(nx));
+        jr.assign(ny, std::vector<double>(nx));
+        ji.assign(ny, std::vector<double>(nx));
+        foam.assign(ny, std::vector<double>(nx, 0));
+        choppy_fftx.reserve(3*ny);
+        for(int i=0 ; i<ny ; i++) choppy_fftx.push_back(new FFT(p_plan_x, &dr[i], &di[i]));
+        for(int i=0 ; i<ny ; i++) choppy_fftx.push_back(new FFT(p_plan_x, &jr[i], &ji[i]));
+        if(with_velocity) {
+            vr.assign(ny, std::vector<double>(nx));
+            vi.assign(ny, std::vector<double>(nx));
+            velocity = &vr;
+            for(int i=0 ; i<ny ; i++) choppy_fftx.push_back(new FFT(p_plan_x, &vr[i], &vi[i]));
+        }
+    }
 }
 
 
@@ -60,104 +112,693 @@ Ocean::Ocean(const double p_lx, const double p_ly, const int p_nx, const int p_n
 Free memory.
 */
 Ocean::~Ocean() {
-    for(int i=0 ; i<nx ; i++) delete ffty[i];
+    delete fft_column;
     for(int i=0 ; i<ny ; i++) delete fftx[i];
+    for(std::size_t i=0 ; i<choppy_fftx.size() ; i++) delete choppy_fftx[i];
 }
 
 /*
 Computes the initial random height field.
 */
-void Ocean::generate_height(Height* const height) {
-    /* real part */
-    for(vec_vec_d_it itx=height0R.begin() ; itx!=height0R.end() ; itx++) {
-        itx->resize(ny+1);
-        height->init_fonctor(std::distance(height0R.begin(), itx));
-        std::generate(itx->begin(), itx->end(), *height);
+void Ocean::generate_height(const Height& height, ThreadPool* const pool) {
+    generate_spectrum(height, pool, &height0R, &height0I);
+    build_active_modes();
+}
+
+/*
+Computes a random height field into R and I, with the columns shared among the
+threads of the pool. Each column is allocated by the thread filling it. This does
+not change the ocean, so it can be done while the ocean is computed.
+*/
+void Ocean::generate_spectrum(const Height& height, ThreadPool* const pool, vec_vec_d* const R, vec_vec_d* const I) const {
+    const int nb_tasks = std::min(nx+1, 8*pool->get_nb_threads());
+    R->resize(nx+1);
+    I->resize(nx+1);
+    pool->run([&](const int i) {
+        for(int x=i ; x<=nx ; x+=nb_tasks) {
+            (*R)[x].resize(ny+1);
+            (*I)[x].resize(ny+1);
+            height.generate_column(x, (*R)[x].data(), (*I)[x].data());
+        }
+    }, nb_tasks);
+}
+
+/*
+Starts a smooth transition from the current initial spectrum to the given one,
+whose content is taken. The transition starts with the next frame and lasts for
+the given time, in seconds: the initial spectrum of each wave goes from the old
+to the new one with a smoothstep, so that neither the surface nor its speed jump.
+With the same seed, both spectra have the same random phases, and the waves only
+grow or shrink. A transition in progress is stopped where it is.
+*/
+void Ocean::fade_to(vec_vec_d* const R, vec_vec_d* const I, const double duration) {
+    if(is_fading()) blend_spectrum(fade_progress);
+    target0R.swap(*R);
+    target0I.swap(*I);
+    fade_started  = false;
+    fade_duration = duration;
+    fade_progress = 0;
+    build_fade_modes();
+}
+
+/*
+Moves the initial spectrum towards the target one by the fraction s.
+*/
+void Ocean::blend_spectrum(const double s) {
+    for(int x=0 ; x<=nx ; x++) {
+        for(int y=0 ; y<=ny ; y++) {
+            height0R[x][y] += s*(target0R[x][y] - height0R[x][y]);
+            height0I[x][y] += s*(target0I[x][y] - height0I[x][y]);
+        }
     }
-    /* imaginary part */
-    for(vec_vec_d_it itx=height0I.begin() ; itx!=height0I.end() ; itx++) {
-        itx->resize(ny+1);
-        height->init_fonctor(std::distance(height0I.begin(), itx));
-        std::generate(itx->begin(), itx->end(), *height);
+}
+
+/*
+Lists the waves updated during a transition: the active waves of both spectra,
+with their initial spectrum in active_modes and their target in target_modes.
+*/
+void Ocean::build_fade_modes() {
+    double max_from = 0;
+    double max_to   = 0;
+    for(int x=nx/2 ; x<nx ; x++) {
+        for(int y=1 ; y<ny ; y++) {
+            if(x==nx/2 && y<=ny/2) continue;
+            max_from = std::max(max_from, pair_energy(height0R, height0I, x, y));
+            max_to   = std::max(max_to,   pair_energy(target0R, target0I, x, y));
+        }
     }
+    active_modes.clear();
+    target_modes.clear();
+    for(int x=nx/2 ; x<nx ; x++) {
+        for(int y=1 ; y<ny ; y++) {
+            if(x==nx/2 && y<=ny/2) continue;
+            const double from = pair_energy(height0R, height0I, x, y);
+            const double to   = pair_energy(target0R, target0I, x, y);
+            if((from<=0 || from<mode_cutoff*max_from) && (to<=0 || to<mode_cutoff*max_to)) continue;
+            active_modes.push_back(make_mode(height0R, height0I, x, y));
+            target_modes.push_back(make_mode(target0R, target0I, x, y));
+        }
+    }
+    if(target_modes.empty()) end_fade();
 }
 
 /*
-Does all the calculus needed for the ocean. This basically means
-updating the spectrum and computing the 2D reverse FFT to get the wave shape.
-The wave shape is stored in the hr vector. hi is generated by the FFT but
-is useless in our application.
+Makes the target spectrum the initial spectrum at the end of a transition.
 */
-void Ocean::main_computation() {
-    for(int x=0 ; x<nx ; x++) {
-        get_sine_amp(x, static_cast<double>(motion_factor*glutGet(GLUT_ELAPSED_TIME))/1000, &HR[x], &HI[x]);
-        ffty[x]->reverse();
+void Ocean::end_fade() {
+    height0R.swap(target0R);
+    height0I.swap(target0I);
+    vec_vec_d().swap(target0R);
+    vec_vec_d().swap(target0I);
+    build_active_modes();
+}
+
+/*
+Copies the initial spectrum and the dispersion table of another ocean
+of the same size, so that both compute the same waves.
+*/
+void Ocean::copy_spectrum(const Ocean& o) {
+    height0R = o.height0R;
+    height0I = o.height0I;
+    omega    = o.omega;
+    build_active_modes();
+}
+
+/*
+Returns the nb of doubles needed to save the state of the ocean: the initial
+spectrum, the dispersion table, and the foam with the time of its last update.
+*/
+const std::size_t Ocean::get_state_size() const {
+    return 3*static_cast<std::size_t>(nx+1)*(ny+1) + 1 + (choppiness!=0 ? static_cast<std::size_t>(nx)*ny : 0);
+}
+
+/*
+Saves the state of the ocean into the given array of get_state_size() doubles.
+The grids are written one column or row after the other.
+*/
+void Ocean::save_state(double* const state) const {
+    double* dst = state;
+    for(int x=0 ; x<=nx ; x++) dst = std::copy(height0R[x].begin(), height0R[x].begin()+ny+1, dst);
+    for(int x=0 ; x<=nx ; x++) dst = std::copy(height0I[x].begin(), height0I[x].begin()+ny+1, dst);
+    for(int x=0 ; x<=nx ; x++) dst = std::copy(omega[x].begin(), omega[x].begin()+ny+1, dst);
+    *dst++ = foam_time;
+    if(choppiness!=0) {
+        for(int y=0 ; y<ny ; y++) dst = std::copy(foam[y].begin(), foam[y].end(), dst);
+    }
+}
+
+/*
+Restores the state of the ocean saved by save_state(). The ocean must have the
+same size and choppiness as the saved one.
+*/
+void Ocean::load_state(const double* const state) {
+    const double* src = state;
+    for(int x=0 ; x<=nx ; x++, src+=ny+1) height0R[x].assign(src, src+ny+1);
+    for(int x=0 ; x<=nx ; x++, src+=ny+1) height0I[x].assign(src, src+ny+1);
+    for(int x=0 ; x<=nx ; x++, src+=ny+1) omega[x].assign(src, src+ny+1);
+    foam_time = *src++;
+    if(choppiness!=0) {
+        for(int y=0 ; y<ny ; y++, src+=nx) foam[y].assign(src, src+nx);
+    }
+    build_active_modes();
+}
+
+/*
+Rounds the angular frequency of every wave to a multiple of 2.pi/period, so that
+the ocean repeats itself every period seconds. The time of the waves being the
+time multiplied by the motion factor, so is the period. No wave is frozen by the
+rounding, except the constant one.
+*/
+void Ocean::quantize_dispersion(const double period) {
+    const double step = 2*M_PI/(period*motion_factor);
+    for(int x=0 ; x<=nx ; x++) {
+        for(int y=0 ; y<=ny ; y++) {
+            if(omega[x][y]>0) omega[x][y] = std::max(1.0, floor(omega[x][y]/step + 0.5))*step;
+        }
+    }
+    build_active_modes();
+}
+
+/*
+Appends to the list every pair of opposite waves of the spectrum with a
+non-zero energy, at least min_energy. Only one half of the grid is walked,
+and the Nyquist row and column are skipped as in get_sine_amp.
+*/
+void Ocean::get_modes(std::vector<Mode>* const modes, const double min_energy) const {
+    for(int x=nx/2 ; x<nx ; x++) {
+        for(int y=1 ; y<ny ; y++) {
+            if(x==nx/2 && y<=ny/2) continue;
+            const double energy = pair_energy(height0R, height0I, x, y);
+            if(energy<=0 || energy<min_energy) continue;
+            modes->push_back(make_mode(height0R, height0I, x, y));
+        }
+    }
+}
+
+/*
+Returns the wave (x, y) of the initial spectrum R + i.I.
+*/
+const Mode Ocean::make_mode(const vec_vec_d& R, const vec_vec_d& I, const int x, const int y) const {
+    Mode m;
+    m.x      = (x-nx/2) & (nx-1);
+    m.y      = (y-ny/2) & (ny-1);
+    m.kx     = (2*M_PI*(x-nx/2))/lx;
+    m.ky     = (2*M_PI*(y-ny/2))/ly;
+    m.omega  = omega[x][y]*motion_factor;
+    m.h0R    = R[x][y];
+    m.h0I    = I[x][y];
+    m.h0mR   = R[nx-x][ny-y];
+    m.h0mI   = I[nx-x][ny-y];
+    m.energy = pair_energy(R, I, x, y);
+    return m;
+}
+
+/*
+Returns |h0(k)|^2 + |h0(-k)|^2 for the wave (x, y) of the initial spectrum R + i.I.
+*/
+inline const double Ocean::pair_energy(const vec_vec_d& R, const vec_vec_d& I, const int x, const int y) const {
+    return R[x][y]*R[x][y] + I[x][y]*I[x][y] + R[nx-x][ny-y]*R[nx-x][ny-y] + I[nx-x][ny-y]*I[nx-x][ny-y];
+}
+
+/*
+Lists the pairs of opposite waves whose energy is at least mode_cutoff times
+the energy of the strongest pair. Only these are updated by main_computation(),
+so the spectrum update costs less when the wind alignment and the minimum wave
+size damp most of the grid. The energies are walked once before the list is
+built, so that the dropped waves are never stored. This stops any transition
+to another spectrum.
+*/
+void Ocean::build_active_modes() {
+    double max_energy = 0;
+    double total      = 0;
+    double kept       = 0;
+    for(int x=nx/2 ; x<nx ; x++) {
+        for(int y=1 ; y<ny ; y++) {
+            if(x==nx/2 && y<=ny/2) continue;
+            const double energy = pair_energy(height0R, height0I, x, y);
+            max_energy = std::max(max_energy, energy);
+            total     += energy;
+        }
+    }
+    active_modes.clear();
+    target_modes.clear();
+    get_modes(&active_modes, mode_cutoff*max_energy);
+    for(std::size_t i=0 ; i<active_modes.size() ; i++) kept += active_modes[i].energy;
+    energy_fraction = total>0 ? kept/total : 1;
+}
+
+/*
+Does all the calculus needed for the ocean at time t, in seconds. This basically
+means updating the spectrum and computing the 2D reverse FFT to get the wave shape.
+The FFT is computed in place, on the rows and then on the columns, and the wave
+shape replaces the spectrum in the hr vector. When the ocean is not choppy, hi
+is generated by the FFT but is useless in our application. Otherwise, it holds
+d(dx)/dz, and the displacement and jacobian terms go through their own FFTs.
+The time is given by the caller so that the ocean does not depend on any clock.
+During a transition to another spectrum, the waves use a blend of both.
+*/
+void Ocean::main_computation(const double t) {
+    const double      time  = motion_factor*t;
+    clock::time_point start = clock::now();
+    if(is_fading()) {
+        if(!fade_started) {
+            fade_started = true;
+            fade_start   = t;
+        }
+        const double s = fade_duration>0 ? std::max(0.0, (t-fade_start)/fade_duration) : 1;
+        if(s>=1) end_fade();
+        else     fade_progress = s*s*(3-2*s);
+    }
+    clear_spectrum();
+    if(is_fading()) {
+        const double s = fade_progress;
+        for(std::size_t i=0 ; i<active_modes.size() ; i++) {
+            Mode        m = active_modes[i];
+            const Mode& n = target_modes[i];
+            m.h0R  += s*(n.h0R  - m.h0R);
+            m.h0I  += s*(n.h0I  - m.h0I);
+            m.h0mR += s*(n.h0mR - m.h0mR);
+            m.h0mI += s*(n.h0mI - m.h0mI);
+            get_sine_amp(m, t);
+        }
+    }
+    else {
+        for(std::size_t i=0 ; i<active_modes.size() ; i++) get_sine_amp(active_modes[i], t);
     }
+    end_stage(SPECTRUM, &start);
+    for(int y=0 ; y<ny ; y++) fftx[y]->reverse();
+    for(std::size_t i=0 ; i<choppy_fftx.size() ; i++) choppy_fftx[i]->reverse();
+    end_stage(FFT_ROWS, &start);
+    reverse_columns(&hr, &hi);
+    if(choppiness!=0) {
+        reverse_columns(&dr, &di);
+        reverse_columns(&jr, &ji);
+        if(with_velocity) reverse_columns(&vr, &vi);
+        end_stage(FFT_COLUMNS, &start);
+        update_foam(time);
+        end_stage(FOAM, &start);
+    }
+    else {
+        end_stage(FFT_COLUMNS, &start);
+    }
+    build_surface();
+    end_stage(SURFACE, &start);
+}
+
+/*
+Adds the time elapsed since start to the given stage, and
+restarts the clock for the next stage.
+*/
+void Ocean::end_stage(const STAGE stage, clock::time_point* const start) {
+    const clock::time_point now = clock::now();
+    stage_time[stage] += std::chrono::duration<double>(now - *start).count();
+    *start = now;
+}
+
+/*
+Prints the average time spent in each stage of main_computation(),
+given the number of frames computed so far.
+*/
+void Ocean::print_timings(std::ostream& os, const int frames) const {
+    const char* const names[NB_STAGES] = {"spectrum update", "FFT on rows", "FFT on columns", "jacobian and foam", "sampling grids"};
+    if(frames<=0) return;
+    for(int i=0 ; i<NB_STAGES ; i++) {
+        os << "   " << names[i] << ": " << 1000*stage_time[i]/frames << " ms/frame" << std::endl;
+    }
+}
+
+/*
+Adds the nb of bytes held by each component of the ocean to bytes, an array
+of NB_COMPONENTS sizes, so that the components of several oceans can be summed.
+*/
+void Ocean::get_memory(std::size_t* const bytes) const {
+    bytes[INITIAL_SPECTRUM] += grid_bytes(height0R) + grid_bytes(height0I) + grid_bytes(target0R) + grid_bytes(target0I);
+    bytes[DISPERSION]       += grid_bytes(omega);
+    bytes[ACTIVE_WAVES]     += sizeof(Mode)*(active_modes.capacity() + target_modes.capacity());
+    bytes[TRANSFORMS]       += grid_bytes(hr) + grid_bytes(hi) + grid_bytes(dr) + grid_bytes(di) + grid_bytes(jr) + grid_bytes(ji) + grid_bytes(vr) + grid_bytes(vi)
+                             + sizeof(double)*(column_r.capacity() + column_i.capacity()) + sizeof(FFT)*(1 + fftx.size() + choppy_fftx.size());
+    bytes[FOAM_GRID]        += grid_bytes(foam);
+    bytes[SAMPLING_GRIDS]   += sizeof(float)*(surface_h.capacity() + surface_dx.capacity() + surface_dz.capacity());
+}
+
+/*
+Returns the name of a component of the ocean, for the memory report.
+*/
+const char* Ocean::component_name(const COMPONENT component) {
+    const char* const names[NB_COMPONENTS] = {"initial spectrum", "dispersion table", "active waves", "transforms", "foam", "sampling grids"};
+    return names[component];
+}
+
+/*
+Returns the nb of bytes held by a grid, with its rows.
+*/
+const std::size_t Ocean::grid_bytes(const vec_vec_d& grid) {
+    std::size_t bytes = sizeof(std::vector<double>)*grid.capacity();
+    for(std::size_t i=0 ; i<grid.size() ; i++) bytes += sizeof(double)*grid[i].capacity();
+    return bytes;
+}
+
+/*
+Sets the whole spectrum to zero. The FFTs are computed in place, so the
+waves that are not active have to be cleared again at each frame.
+*/
+void Ocean::clear_spectrum() {
     for(int y=0 ; y<ny ; y++) {
-        int      x;
-        vec_d_it it;
-        for(it=hr[y].begin(), x=0 ; it!=hr[y].end() ; it++, x++) *it = HR[x][y];
-        for(it=hi[y].begin(), x=0 ; it!=hi[y].end() ; it++, x++) *it = HI[x][y];
-        fftx[y]->reverse();
+        std::fill(hr[y].begin(), hr[y].end(), 0);
+        std::fill(hi[y].begin(), hi[y].end(), 0);
+        if(choppiness!=0) {
+            std::fill(dr[y].begin(), dr[y].end(), 0);
+            std::fill(di[y].begin(), di[y].end(), 0);
+            std::fill(jr[y].begin(), jr[y].end(), 0);
+            std::fill(ji[y].begin(), ji[y].end(), 0);
+            if(with_velocity) {
+                std::fill(vr[y].begin(), vr[y].end(), 0);
+                std::fill(vi[y].begin(), vi[y].end(), 0);
+            }
+        }
     }
 }
 
 /*
-Updates the wave height field.
+Updates the wave height field of a pair of opposite waves, using the dispersion table. The wave is
+written at its shifted index, so that the time-domain signal comes out of the FFTs with its right sign.
+The Nyquist row and column have no conjugate on the grid and are never active, so that every
+spectrum is hermitian and gives a real signal. Two real signals can then share
+one complex transform: with choppy waves, the height carries d(dx)/dz in its
+imaginary part, the displacement is dx + i.dz and the jacobian terms are
+d(dx)/dx + i.d(dz)/dz. All of them are derived from the same H(k, t), and
+H(-k, t) is its conjugate.
+The time derivative of H(k, t) is known analytically. Without choppy waves,
+it goes into the imaginary part of the height, and otherwise in its own transform.
 */
-void Ocean::get_sine_amp(const int x, const double time, std::vector<double>* const p_HR, std::vector<double>* const p_HI) const {
-    double   A;
-    double   L = 0.1;
-    int      y;
-    vec_d_it itR;
-    vec_d_it itI;
-    for(itR=p_HR->begin(), itI=p_HI->begin(), y=0 ; itR!=p_HR->end() ; itR++, itI++, y++) {
-        A = time*sqrt(9.81 * sqrt(pow((2*M_PI*x)/lx, 2)+pow((2*M_PI*y)/ly, 2)) * (1+(pow((2*M_PI*x)/lx, 2)+pow((2*M_PI*y)/ly, 2))*pow(L, 2)));
-        *itR = height0R[x][y]*cos(A) - height0I[x][y]*sin(A) + height0R[nx-x][ny-y]*cos(-A) + height0I[nx-x][ny-y]*sin(-A);
-        *itI = height0I[x][y]*cos(A) + height0R[x][y]*sin(A) - height0I[nx-x][ny-y]*cos(-A) + height0R[nx-x][ny-y]*sin(-A);
+void Ocean::get_sine_amp(const Mode& m, const double t) {
+    const double c  = cos(m.omega*t);
+    const double s  = sin(m.omega*t);
+    const double hR = m.h0R*c - m.h0I*s + m.h0mR*c - m.h0mI*s;
+    const double hI = m.h0I*c + m.h0R*s - m.h0mI*c - m.h0mR*s;
+    double       vR = 0;
+    double       vI = 0;
+    if(with_velocity) {
+        vR = -m.omega*(m.h0I*c + m.h0R*s + m.h0mR*s + m.h0mI*c);
+        vI =  m.omega*(m.h0R*c - m.h0I*s - m.h0mR*c + m.h0mI*s);
+    }
+    if(choppiness==0) {
+        scatter(&hr, &hi, m.x, m.y, hR, hI, vR, vI);
+        return;
     }
+    const double k   = sqrt(m.kx*m.kx + m.ky*m.ky);
+    const double ux  = m.kx/k;
+    const double uy  = m.ky/k;
+    const double jxx = m.kx*ux;
+    const double jyy = m.ky*uy;
+    const double jxy = m.kx*uy;
+    scatter(&hr, &hi, m.x, m.y, hR, hI, jxy*hR, jxy*hI);
+    scatter(&dr, &di, m.x, m.y, ux*hI, -ux*hR, uy*hI, -uy*hR);
+    scatter(&jr, &ji, m.x, m.y, jxx*hR, jxx*hI, jyy*hR, jyy*hI);
+    if(with_velocity) scatter(&vr, &vi, m.x, m.y, vR, vI, 0, 0);
 }
 
 /*
-Creates an array that OpenGL can directly use - X
+Writes F + i.G at the wave (x, y) of the given shifted spectrum - [y][x], where F and G
+are the spectra of two real signals. At the opposite wave, this is conj(F) + i.conj(G).
 */
-void Ocean::init_gl_vertex_array_x(const int y, double* const vertices) const {
+void Ocean::scatter(vec_vec_d* const R, vec_vec_d* const I, const int x, const int y, const double FR, const double FI, const double GR, const double GI) const {
+    const int xm = (nx-x) & (nx-1);
+    const int ym = (ny-y) & (ny-1);
+    (*R)[y][x]   = FR - GI;
+    (*I)[y][x]   = FI + GR;
+    (*R)[ym][xm] = FR + GI;
+    (*I)[ym][xm] = GR - FI;
+}
+
+/*
+Computes the FFT of each column of r + i.i in place, the rows being already
+transformed. Each column is copied into a single column buffer and back, so
+that the grid is never stored twice.
+*/
+void Ocean::reverse_columns(vec_vec_d* const r, vec_vec_d* const i) {
     for(int x=0 ; x<nx ; x++) {
-        vertices[3*x]   = (lx/nx)*x;
-        vertices[3*x+2] = (ly/ny)*y;
+        for(int y=0 ; y<ny ; y++) {
+            column_r[y] = (*r)[y][x];
+            column_i[y] = (*i)[y][x];
+        }
+        fft_column->reverse();
+        for(int y=0 ; y<ny ; y++) {
+            (*r)[y][x] = column_r[y];
+            (*i)[y][x] = column_i[y];
+        }
     }
-    vertices[3*nx]   = lx;
-    vertices[3*nx+2] = (ly/ny)*y;
 }
 
 /*
-Creates an array that OpenGL can directly use - Y
+Computes the jacobian determinant of the displacement and updates the foam
+coverage in place, the jacobian itself not being stored. Where the jacobian
+goes below the threshold, the surface is about to fold and foam is created.
+Otherwise, the previous foam fades exponentially with the time constant foam_decay.
 */
-void Ocean::init_gl_vertex_array_y(const int x, double* const vertices) const {
+void Ocean::update_foam(const double time) {
+    const double decay = foam_decay>0 ? exp(-std::abs(time-foam_time)/foam_decay) : 0;
+    foam_time = time;
     for(int y=0 ; y<ny ; y++) {
-        vertices[3*y]   = (lx/nx)*x;
-        vertices[3*y+2] = (ly/ny)*y;
+        for(int x=0 ; x<nx ; x++) {
+            const double jxx = choppiness*jr[y][x];
+            const double jyy = choppiness*ji[y][x];
+            const double jxy = choppiness*hi[y][x];
+            const double J   = (1+jxx)*(1+jyy) - jxy*jxy;
+            const double cov = std::min(1.0, std::max(0.0, foam_threshold-J));
+            foam[y][x] = std::max(foam[y][x]*decay, cov);
+        }
     }
-    vertices[3*ny]   = (lx/nx)*x;
-    vertices[3*ny+2] = ly;
 }
 
 /*
-Creates an array that OpenGL can directly use - X
+Writes the positions of the row y of vertices, for y in [0 ; ny], into a buffer
+with the layout of a Heightfield. The ocean is periodic, so the row ny and the
+column nx are the same as the row 0 and the column 0, moved by ly or lx.
 */
-void Ocean::gl_vertex_array_x(const int y, double* const vertices) const {
+void Ocean::vertex_row(const int y, float* const vertices) const {
+    const int           S  = Heightfield::STRIDE;
+    const int           yw = y & (ny-1);
+    const double* const h  = hr[yw].data();
+    const double        sx = lx/nx;
+    const float         z  = (ly/ny)*y;
+    if(choppiness==0) {
+        for(int x=0 ; x<nx ; x++) {
+            vertices[S*x]   = sx*x;
+            vertices[S*x+1] = h[x];
+            vertices[S*x+2] = z;
+        }
+        vertices[S*nx]   = lx;
+        vertices[S*nx+1] = h[0];
+        vertices[S*nx+2] = z;
+        return;
+    }
+    const double* const d = dr[yw].data();
+    const double* const e = di[yw].data();
     for(int x=0 ; x<nx ; x++) {
-        vertices[3*x+1] = pow(-1, x+y)*hr[y][x];
+        vertices[S*x]   = sx*x + choppiness*d[x];
+        vertices[S*x+1] = h[x];
+        vertices[S*x+2] = z + choppiness*e[x];
     }
-    vertices[3*nx+1] = pow(-1, nx+y)*hr[y][0];
+    vertices[S*nx]   = lx + choppiness*d[0];
+    vertices[S*nx+1] = h[0];
+    vertices[S*nx+2] = z + choppiness*e[0];
+}
+
+/*
+Writes the time derivative of the height of the row y of vertices.
+*/
+void Ocean::rate_row(const int y, float* const rates) const {
+    const std::vector<double>& v = (*velocity)[y & (ny-1)];
+    for(int x=0 ; x<nx ; x++) rates[x] = v[x];
+    rates[nx] = v[0];
 }
 
 /*
-Creates an array that OpenGL can directly use - Y
+Copies the time-domain results into the flat grids used for the sampling,
+with the choppiness for the displacement.
 */
-void Ocean::gl_vertex_array_y(const int x, double* const vertices) const {
+void Ocean::build_surface() {
     for(int y=0 ; y<ny ; y++) {
-        vertices[3*y+1] = pow(-1, x+y)*hr[y][x];
+        std::copy(hr[y].begin(), hr[y].end(), &surface_h[nx*y]);
+        if(choppiness!=0) {
+            float* const dx = &surface_dx[nx*y];
+            float* const dz = &surface_dz[nx*y];
+            for(int x=0 ; x<nx ; x++) {
+                dx[x] = choppiness*dr[y][x];
+                dz[x] = choppiness*di[y][x];
+            }
+        }
+    }
+}
+
+/*
+Interpolates the periodic grid at the m grid coordinates (gx, gy). The grid size
+being a power of 2, wrapping an index is a bit mask. The coordinates, weights and
+indices are computed in separate loops that the compiler can vectorize, the only
+scalar part being the reading of the grid values.
+Bicubic interpolation uses Catmull-Rom splines on a 4x4 neighbourhood.
+*/
+void Ocean::interpolate(const std::vector<float>& grid, const float* const gx, const float* const gy, float* const out, const int m, const INTERPOLATION interpolation) const {
+    const int   mx = nx-1;
+    const int   my = ny-1;
+    const float* g = grid.data();
+    int         ix[SAMPLE_BLOCK];
+    int         iy[SAMPLE_BLOCK];
+    float       fx[SAMPLE_BLOCK];
+    float       fy[SAMPLE_BLOCK];
+    for(int j=0 ; j<m ; j++) {
+        const float x0 = floorf(gx[j]);
+        const float y0 = floorf(gy[j]);
+        fx[j] = gx[j] - x0;
+        fy[j] = gy[j] - y0;
+        ix[j] = static_cast<int>(x0);
+        iy[j] = static_cast<int>(y0);
+    }
+    if(interpolation==BILINEAR) {
+        for(int j=0 ; j<m ; j++) {
+            const int   x0  = ix[j] & mx;
+            const int   x1  = (ix[j]+1) & mx;
+            const int   y0  = nx*(iy[j] & my);
+            const int   y1  = nx*((iy[j]+1) & my);
+            const float v00 = g[y0+x0];
+            const float v10 = g[y0+x1];
+            const float v01 = g[y1+x0];
+            const float v11 = g[y1+x1];
+            const float a   = v00 + fx[j]*(v10-v00);
+            const float b   = v01 + fx[j]*(v11-v01);
+            out[j] = a + fy[j]*(b-a);
+        }
+    }
+    else {
+        for(int j=0 ; j<m ; j++) {
+            float wx[4];
+            float wy[4];
+            const float tx = fx[j];
+            const float ty = fy[j];
+            wx[0] = 0.5f*((-tx + 2)*tx - 1)*tx;
+            wx[1] = 0.5f*((3*tx - 5)*tx*tx + 2);
+            wx[2] = 0.5f*((-3*tx + 4)*tx + 1)*tx;
+            wx[3] = 0.5f*(tx - 1)*tx*tx;
+            wy[0] = 0.5f*((-ty + 2)*ty - 1)*ty;
+            wy[1] = 0.5f*((3*ty - 5)*ty*ty + 2);
+            wy[2] = 0.5f*((-3*ty + 4)*ty + 1)*ty;
+            wy[3] = 0.5f*(ty - 1)*ty*ty;
+            float value = 0;
+            for(int b=0 ; b<4 ; b++) {
+                const float* const row = g + nx*((iy[j]+b-1) & my);
+                float              r   = 0;
+                for(int a=0 ; a<4 ; a++) r += wx[a]*row[(ix[j]+a-1) & mx];
+                value += wy[b]*r;
+            }
+            out[j] = value;
+        }
+    }
+}
+
+/*
+Adds to out the height of the ocean at the n grid points of actual positions
+(xs[i], zs[i]), which are the positions before the horizontal displacement.
+*/
+void Ocean::add_heights(const float* const xs, const float* const zs, float* const out, const std::size_t n, const INTERPOLATION interpolation) const {
+    const float sx = nx/lx;
+    const float sy = ny/ly;
+    float       gx[SAMPLE_BLOCK];
+    float       gy[SAMPLE_BLOCK];
+    float       h[SAMPLE_BLOCK];
+    for(std::size_t i=0 ; i<n ; i+=SAMPLE_BLOCK) {
+        const int m = static_cast<int>(std::min<std::size_t>(SAMPLE_BLOCK, n-i));
+        for(int j=0 ; j<m ; j++) {
+            gx[j] = xs[i+j]*sx;
+            gy[j] = zs[i+j]*sy;
+        }
+        interpolate(surface_h, gx, gy, h, m, interpolation);
+        for(int j=0 ; j<m ; j++) out[i+j] += h[j];
+    }
+}
+
+/*
+Adds to (dx, dz) the horizontal displacement of the n grid points of actual
+positions (xs[i], zs[i]), if the ocean is choppy.
+*/
+void Ocean::add_displacements(const float* const xs, const float* const zs, float* const dx, float* const dz, const std::size_t n) const {
+    const float sx = nx/lx;
+    const float sy = ny/ly;
+    float       gx[SAMPLE_BLOCK];
+    float       gy[SAMPLE_BLOCK];
+    float       d[SAMPLE_BLOCK];
+    if(choppiness==0) return;
+    for(std::size_t i=0 ; i<n ; i+=SAMPLE_BLOCK) {
+        const int m = static_cast<int>(std::min<std::size_t>(SAMPLE_BLOCK, n-i));
+        for(int j=0 ; j<m ; j++) {
+            gx[j] = xs[i+j]*sx;
+            gy[j] = zs[i+j]*sy;
+        }
+        interpolate(surface_dx, gx, gy, d, m, BILINEAR);
+        for(int j=0 ; j<m ; j++) dx[i+j] += d[j];
+        interpolate(surface_dz, gx, gy, d, m, BILINEAR);
+        for(int j=0 ; j<m ; j++) dz[i+j] += d[j];
+    }
+}
+
+/*
+Adds to h, dx, dz, and rates if not null, the height, the horizontal displacement
+and the time derivative of the height of the ocean at the n grid points of actual
+positions (step.i, z), i being in [0 ; n[. The grid rows around z are the same
+for all the points, so they are first blended into one line with the weights along
+z, in loops the compiler vectorizes, and each point then only interpolates its line,
+which is padded so that no index wraps but the first one. The heights and their
+derivatives use Catmull-Rom splines, the displacements a linear interpolation, as
+with interpolate().
+*/
+void Ocean::add_row(const float z, const float step, const int n, float* const h, float* const dx, float* const dz, float* const rates) const {
+    const float        gy = z*ny/ly;
+    const float        gs = step*nx/lx;
+    const float        y0 = floorf(gy);
+    const float        ty = gy - y0;
+    const int          iy = static_cast<int>(y0);
+    const int          mx = nx-1;
+    const int          my = ny-1;
+    const float        w0 = 0.5f*((-ty + 2)*ty - 1)*ty;
+    const float        w1 = 0.5f*((3*ty - 5)*ty*ty + 2);
+    const float        w2 = 0.5f*((-3*ty + 4)*ty + 1)*ty;
+    const float        w3 = 0.5f*(ty - 1)*ty*ty;
+    std::vector<float> line(nx+3);
+    float* const       l  = line.data();
+    const auto cubic = [&](const float* const r0, const float* const r1, const float* const r2, const float* const r3, float* const out) {
+        for(int x=0 ; x<nx ; x++) l[x+1] = w0*r0[x] + w1*r1[x] + w2*r2[x] + w3*r3[x];
+        l[0]    = l[nx];
+        l[nx+1] = l[1];
+        l[nx+2] = l[2];
+        for(int i=0 ; i<n ; i++) {
+            const float        gx = gs*i;
+            const float        x0 = floorf(gx);
+            const float        tx = gx - x0;
+            const float* const p  = l + (static_cast<int>(x0) & mx);
+            out[i] += 0.5f*((-tx + 2)*tx - 1)*tx*p[0] + 0.5f*((3*tx - 5)*tx*tx + 2)*p[1] + 0.5f*((-3*tx + 4)*tx + 1)*tx*p[2] + 0.5f*(tx - 1)*tx*tx*p[3];
+        }
+    };
+    const auto linear = [&](const std::vector<float>& grid, float* const out) {
+        const float* const a = &grid[nx*(iy & my)];
+        const float* const b = &grid[nx*((iy+1) & my)];
+        for(int x=0 ; x<nx ; x++) l[x] = a[x] + ty*(b[x]-a[x]);
+        l[nx] = l[0];
+        for(int i=0 ; i<n ; i++) {
+            const float        gx = gs*i;
+            const float        x0 = floorf(gx);
+            const float        tx = gx - x0;
+            const float* const p  = l + (static_cast<int>(x0) & mx);
+            out[i] += p[0] + tx*(p[1]-p[0]);
+        }
+    };
+    cubic(&surface_h[nx*((iy-1) & my)], &surface_h[nx*(iy & my)], &surface_h[nx*((iy+1) & my)], &surface_h[nx*((iy+2) & my)], h);
+    if(choppiness!=0) {
+        linear(surface_dx, dx);
+        linear(surface_dz, dz);
+    }
+    if(rates) {
+        std::vector<float> v(4*nx);
+        for(int b=0 ; b<4 ; b++) std::copy((*velocity)[(iy+b-1) & my].begin(), (*velocity)[(iy+b-1) & my].end(), &v[nx*b]);
+        cubic(&v[0], &v[nx], &v[2*nx], &v[3*nx], rates);
     }
-    vertices[3*ny+1] = pow(-1, x+ny)*hr[0][x];
 }
@@ -22,64 +22,173 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 /*
-This class implements an ocean. The initial spectrum is computed with generate_height_0(), and
-stored into HR/HI vectors. An fft object can trasform this into a time-domain signal that is
-stored in the hr/hi vectors. Over time, the spectrum is updated with get_sine_amp to give an
-impression of movement.
+This class implements an ocean. The initial spectrum is computed with generate_height(), and
+stored into height0R/height0I vectors. At each frame, the spectrum is updated with get_sine_amp
+into the hr/hi vectors, and fft objects transform it in place into a time-domain signal, which
+gives an impression of movement. The time-domain signal never has a copy of its own.
+The spectrum is shifted so that k=0 is at the index 0, which gives the signal with its
+right sign, without the (-1)^(x+y) factor of a centered spectrum.
+When the choppiness is not zero, the same pass over the spectrum also produces the horizontal
+displacement and its partial derivatives. Two real fields share one complex transform, so the
+displacement (dx, dz) and the Jacobian terms only cost two more 2D FFTs. The Jacobian determinant
+of the displacement tells where the surface folds over itself, which feeds a foam coverage buffer
+that fades away with time.
+The time derivative of the height can also be computed, for the rendering to interpolate
+between two frames. It is carried by the imaginary part of the height transform when the
+ocean is not choppy, and needs one more transform otherwise.
+Only the waves whose energy is above a fraction of the most energetic one are updated at each
+frame: they are listed once, by pairs of opposite waves, and scattered into a cleared spectrum.
+The angular frequency of each wave is computed once into a dispersion table, which takes the
+depth of the sea into account at no cost per frame. It can be
+quantized to multiples of 2.pi/T, which makes the ocean periodic in time with period T.
+A new initial spectrum can be computed while the ocean runs, and the ocean then fades
+smoothly from the old spectrum to the new one over a few seconds.
+The initial spectrum, the dispersion table and the foam can be saved to a flat array of doubles
+and loaded back, so that an ocean can be restored without being generated again.
+After each computation, the heights and displacements are also copied into flat float
+grids. add_heights() and add_displacements() interpolate them at any actual position
+of the grid, before its displacement, for a cascade to sum several oceans and to find
+the point seen at a position (see Cascade::sample_heights()), and add_row() reads them
+along a row of a finer frame.
+get_memory() gives the memory held by each component, to size the oceans of a server.
 */
 
 #ifndef OCEANHPP
 #define OCEANHPP
 
+#include <chrono>
+#include <iostream>
 #include <vector>
 
 #include "fft/FFT.hpp"
+#include "parallel/ThreadPool.hpp"
 #include "Height.hpp"
-#include "Philipps.hpp"
+#include "Mode.hpp"
 
 class Ocean {
     
     public:
+
+        typedef std::vector<std::vector<double>> vec_vec_d;
+
+        enum STAGE {SPECTRUM, FFT_ROWS, FFT_COLUMNS, FOAM, SURFACE, NB_STAGES};   /* steps of main_computation() */
+        enum COMPONENT {INITIAL_SPECTRUM, DISPERSION, ACTIVE_WAVES, TRANSFORMS, FOAM_GRID, SAMPLING_GRIDS, NB_COMPONENTS};   /* memory of get_memory() */
+        enum INTERPOLATION {BILINEAR, BICUBIC};                                /* sampling of the surface */
+
+        static const int SAMPLE_BLOCK      = 64;   /* nb of positions sampled together */
+        static const int CHOPPY_ITERATIONS = 4;    /* iterations to invert the displacement */
     
-        Ocean(const double, const double, const int, const int, const double);
+        Ocean(const double, const double, const int, const int, const double, const double, const double, const double, const bool, const double, const double, const FFTPlan* const, const FFTPlan* const);
         ~Ocean();
     
-        const int get_lx() { return lx; }
-        const int get_ly() { return ly; }
-        const int get_nx() { return nx; }
-        const int get_ny() { return ny; }
+        const double get_lx() { return lx; }
+        const double get_ly() { return ly; }
+        const int    get_nx() { return nx; }
+        const int    get_ny() { return ny; }
+        const double get_choppiness() const { return choppiness; }
+        const bool   has_velocity()   const { return with_velocity; }
+        const int    get_nb_active_modes()  const { return static_cast<int>(active_modes.size()); }
+        const std::vector<Mode>& get_active_modes() const { return active_modes; }
+        const double get_energy_fraction()  const { return energy_fraction; }
+        const bool   is_fading()            const { return !target_modes.empty(); }
     
-        void generate_height(Height* const);
-        void main_computation();
-        void init_gl_vertex_array_x(const int, double* const) const;
-        void init_gl_vertex_array_y(const int, double* const) const;
-        void gl_vertex_array_x(const int, double* const)      const;
-        void gl_vertex_array_y(const int, double* const)      const;
+        const vec_vec_d& get_foam() const { return foam; }
+    
+        void generate_height(const Height&, ThreadPool* const);
+        void generate_spectrum(const Height&, ThreadPool* const, vec_vec_d* const, vec_vec_d* const) const;
+        void fade_to(vec_vec_d* const, vec_vec_d* const, const double);
+        void copy_spectrum(const Ocean&);
+        void quantize_dispersion(const double);
+        void get_modes(std::vector<Mode>* const, const double=0) const;
+        const std::size_t get_state_size() const;
+        void save_state(double* const) const;
+        void load_state(const double* const);
+        void main_computation(const double);
+        void print_timings(std::ostream&, const int) const;
+        void get_memory(std::size_t* const) const;
+        void vertex_row(const int, float* const) const;
+        void rate_row(const int, float* const)   const;
+        void add_heights(const float* const, const float* const, float* const, const std::size_t, const INTERPOLATION=BILINEAR) const;
+        void add_displacements(const float* const, const float* const, float* const, float* const, const std::size_t) const;
+        void add_row(const float, const float, const int, float* const, float* const, float* const, float* const) const;
+
+        static const char* component_name(const COMPONENT);
     
     private:
 
         typedef std::vector<double>::iterator              vec_d_it;
-        typedef std::vector<std::vector<double>>           vec_vec_d;
         typedef std::vector<std::vector<double>>::iterator vec_vec_d_it;
+        typedef std::chrono::steady_clock                  clock;
+
+        static const double G;                        /* gravity */
+        static const double SURFACE_TENSION;          /* surface tension of water over its density */
     
-        void get_sine_amp(const int, const double, std::vector<double>* const, std::vector<double>* const) const;
+        const double pair_energy(const vec_vec_d&, const vec_vec_d&, const int, const int) const;
+        const Mode   make_mode(const vec_vec_d&, const vec_vec_d&, const int, const int) const;
+        void build_active_modes();
+        void build_fade_modes();
+        void blend_spectrum(const double);
+        void end_fade();
+        void clear_spectrum();
+        void get_sine_amp(const Mode&, const double);
+        void scatter(vec_vec_d* const, vec_vec_d* const, const int, const int, const double, const double, const double, const double) const;
+        void reverse_columns(vec_vec_d* const, vec_vec_d* const);
+        void update_foam(const double);
+        void end_stage(const STAGE, clock::time_point* const);
+        void build_surface();
+        void interpolate(const std::vector<float>&, const float* const, const float* const, float* const, const int, const INTERPOLATION) const;
+
+        static const std::size_t grid_bytes(const vec_vec_d&);
     
         const double      lx;              /* actual width */
         const double      ly;              /* actual height */
         const int         nx;              /* nb of x points - must be a power of 2 */
         const int         ny;              /* nb of y points - must be a power of 2 */
         const double      motion_factor;
+        const double      choppiness;      /* horizontal displacement factor, no displacement if zero */
+        const double      foam_threshold;  /* foam appears where the jacobian goes below this value */
+        const double      foam_decay;      /* time constant of the foam fading, in seconds */
+        const double      depth;           /* depth of the sea, for the dispersion of the waves */
+        double            foam_time;       /* time of the last foam update */
+        const bool        with_velocity;   /* true to compute the time derivative of the height */
+        vec_vec_d*        velocity;        /* time derivative of the height - [y][x], hi or vr */
   
         vec_vec_d         height0R;        /* initial wave height field (spectrum) - real part */
         vec_vec_d         height0I;        /* initial wave height field (spectrum) - imaginary part */
+        vec_vec_d         omega;           /* dispersion table, angular frequency of each wave - [x][y] */
+        const double      mode_cutoff;     /* waves with less energy than this fraction of the strongest one are dropped */
+        std::vector<Mode> active_modes;    /* pairs of opposite waves updated at each frame */
+        double            energy_fraction; /* energy of the active waves over the total energy */
+        vec_vec_d         target0R;        /* initial spectrum faded to - real part */
+        vec_vec_d         target0I;        /* initial spectrum faded to - imaginary part */
+        std::vector<Mode> target_modes;    /* active waves with their target spectrum, as in active_modes, or empty */
+        bool              fade_started;    /* false until the first frame of the transition */
+        double            fade_start;      /* time of the first frame of the transition */
+        double            fade_duration;   /* duration of the transition, in seconds */
+        double            fade_progress;   /* fraction of the transition done at the last frame */
+    
+        vec_vec_d         hr;              /* shifted spectrum, then time domain, real part      - [y][x] - wave height */
+        vec_vec_d         hi;              /* shifted spectrum, then time domain, imaginary part - [y][x] - d(dx)/dz if choppy, else velocity */
+    
+        vec_vec_d         dr;              /* displacement spectrum, then displacement along x - [y][x] */
+        vec_vec_d         di;              /* displacement spectrum, then displacement along z - [y][x] */
+        vec_vec_d         jr;              /* jacobian terms spectrum, then d(dx)/dx - [y][x] */
+        vec_vec_d         ji;              /* jacobian terms spectrum, then d(dz)/dz - [y][x] */
+        vec_vec_d         foam;            /* foam coverage in [0 ; 1] - [y][x] */
+        vec_vec_d         vr;              /* height time derivative spectrum, then height time derivative if choppy - [y][x] */
+        vec_vec_d         vi;              /* imaginary part, useless - [y][x] */
+        std::vector<double> column_r;      /* one column of a grid, for the FFT on columns - real part */
+        std::vector<double> column_i;      /* one column of a grid, for the FFT on columns - imaginary part */
+    
+        std::vector<float> surface_h;      /* signed height, for the sampling - [y*nx+x] */
+        std::vector<float> surface_dx;     /* signed displacement along x times the choppiness - [y*nx+x] */
+        std::vector<float> surface_dz;     /* signed displacement along z times the choppiness - [y*nx+x] */
     
-        vec_vec_d         HR;              /* frequency domain, real part      - [y][x] */
-        vec_vec_d         HI;              /* frequency domain, imaginary part - [y][x] */
-        vec_vec_d         hr;              /* time domain, real part      - [y][x] */
-        vec_vec_d         hi;              /* time domain, imaginary part - [y][x] */
+        std::vector<FFT*> fftx;            /* fft structures to compute the FFT on rows */
+        FFT*              fft_column;      /* fft structure to compute the FFT on the column buffer */
+        std::vector<FFT*> choppy_fftx;     /* fft structures for the displacement, jacobian and velocity rows */
     
-        std::vector<FFT*> fftx;            /* fft structure to compute the FFT */
-        std::vector<FFT*> ffty;            /* fft structure to compute the FFT */
+        double            stage_time[NB_STAGES];   /* time spent in each stage since the creation, in seconds */
     
     
 };
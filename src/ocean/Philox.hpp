@@ -0,0 +1,122 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class implements the Philox4x32-10 counter-based random generator of Salmon et al.
+("Parallel random numbers: as easy as 1, 2, 3"). There is no state: four 32-bit random
+numbers are a function of a 128-bit counter and a 64-bit key, so that every wave of the
+spectrum draws its numbers from its own stream, keyed by the seed and indexed by the
+position of the wave. The ocean is then the same for a given seed whatever the number of
+threads computing it, or the machine it runs on.
+The generator only uses integer multiplications and exclusive ors. Gaussian numbers are
+drawn by blocks, in two loops that the compiler can vectorize: one for the random bits,
+and one for the Box-Muller transform.
+*/
+
+#ifndef PHILOXHPP
+#define PHILOXHPP
+
+#include <cmath>
+#include <cstdint>
+
+class Philox {
+
+    public:
+
+        Philox(const uint32_t p_key0, const uint32_t p_key1) : key0(p_key0), key1(p_key1) {}
+        ~Philox() {}
+
+        static const int BLOCK = 64;   /* nb of gaussian numbers drawn together */
+
+        inline void operator()(const uint32_t, const uint32_t, const uint32_t, const uint32_t, uint32_t* const) const;
+        inline void gaussians(const uint32_t, const uint32_t, const int, double* const, double* const) const;
+
+    private:
+
+        static const int      ROUNDS = 10;           /* number of rounds, 10 is the smallest safe value */
+        static const uint32_t M0     = 0xD2511F53;   /* multipliers */
+        static const uint32_t M1     = 0xCD9E8D57;
+        static const uint32_t W0     = 0x9E3779B9;   /* key increments, golden ratio and sqrt(3)-1 */
+        static const uint32_t W1     = 0xBB67AE85;
+
+        const uint32_t key0;   /* key, usually the seed */
+        const uint32_t key1;   /* key, usually the stream */
+
+};
+
+/*
+Computes the four random numbers of the given counter.
+*/
+inline void Philox::operator()(const uint32_t p_c0, const uint32_t p_c1, const uint32_t p_c2, const uint32_t p_c3, uint32_t* const out) const {
+    uint32_t c0 = p_c0;
+    uint32_t c1 = p_c1;
+    uint32_t c2 = p_c2;
+    uint32_t c3 = p_c3;
+    uint32_t k0 = key0;
+    uint32_t k1 = key1;
+    for(int i=0 ; i<ROUNDS ; i++) {
+        const uint64_t p0 = static_cast<uint64_t>(M0)*c0;
+        const uint64_t p1 = static_cast<uint64_t>(M1)*c2;
+        c0 = static_cast<uint32_t>(p1>>32) ^ c1 ^ k0;
+        c2 = static_cast<uint32_t>(p0>>32) ^ c3 ^ k1;
+        c1 = static_cast<uint32_t>(p1);
+        c3 = static_cast<uint32_t>(p0);
+        k0 += W0;
+        k1 += W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*
+Computes two independent gaussian numbers of unit variance for each of the n
+counters (x, y), ..., (x, y+n-1), with the Box-Muller method. Unlike its polar
+form, there is no rejection loop. The random numbers are turned into uniform
+numbers in ]0 ; 1[ through signed integers, which the vector units can convert,
+and the sine is computed as a shifted cosine, as the vectorized math library
+has no sincos function.
+*/
+inline void Philox::gaussians(const uint32_t x, const uint32_t y, const int n, double* const g0, double* const g1) const {
+    const double scale = 1.0/4294967296.0;
+    int32_t      u0[BLOCK];
+    int32_t      u1[BLOCK];
+    for(int b=0 ; b<n ; b+=BLOCK) {
+        const int m = n-b<BLOCK ? n-b : BLOCK;
+        for(int i=0 ; i<m ; i++) {
+            uint32_t r[4];
+            (*this)(x, y+b+i, 0, 0, r);
+            u0[i] = static_cast<int32_t>(r[0]^0x80000000u);
+            u1[i] = static_cast<int32_t>(r[1]^0x80000000u);
+        }
+        for(int i=0 ; i<m ; i++) {
+            const double radius = sqrt(-2*log((u0[i] + 2147483648.5)*scale));
+            const double angle  = 2*M_PI*(u1[i] + 2147483648.5)*scale - M_PI;
+            g0[b+i] = radius*cos(angle);
+            g1[b+i] = radius*cos(angle - M_PI/2);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Publisher.hpp"
+
+/*
+Initializes the variables. The displacements are published if the ocean is
+choppy, and the normals if asked. Nothing is shared before open() is called.
+*/
+Publisher::Publisher(Cascade* const p_ocean, const bool p_normals) :
+    lx(p_ocean->get_lx()),
+    ly(p_ocean->get_ly()),
+    nx(p_ocean->get_frame_nx()),
+    ny(p_ocean->get_frame_ny()),
+    channels(Heightfield::HEIGHTS | (p_ocean->get_ocean(0)->get_choppiness()!=0 ? Heightfield::DISPLACEMENTS : 0) | (p_normals ? Heightfield::NORMALS : 0)),
+    frame_size(static_cast<std::size_t>(Heightfield::nb_floats(channels))*(nx+1)*(ny+1)),
+    mapping(nullptr),
+    mapping_size(0),
+    head(nullptr),
+    published(0) {
+}
+
+/*
+Tells the readers that the publisher stopped, and removes the shared memory.
+*/
+Publisher::~Publisher() {
+    if(!mapping) return;
+    head->alive.store(0, std::memory_order_release);
+    munmap(mapping, mapping_size);
+    shm_unlink(name.c_str());
+}
+
+/*
+Creates the shared memory of the given name, which starts with a '/', replacing
+any previous one, so that the readers which open it find the new dimensions.
+*/
+void Publisher::open(const std::string& p_name) {
+    const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t slot = (sizeof(FrameRing::slot) + sizeof(float)*frame_size + page - 1)/page*page;
+    name         = p_name;
+    mapping_size = page + FrameRing::NB_SLOTS*slot;
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd<0) throw std::runtime_error("cannot create the shared memory " + name);
+    if(ftruncate(fd, mapping_size)!=0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot resize the shared memory " + name);
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping==MAP_FAILED) {
+        mapping = nullptr;
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot map the shared memory " + name);
+    }
+    head              = static_cast<FrameRing::header*>(mapping);
+    head->version     = FrameRing::VERSION;
+    head->nb_slots    = FrameRing::NB_SLOTS;
+    head->nx          = nx;
+    head->ny          = ny;
+    head->channels    = channels;
+    head->nb_floats   = Heightfield::nb_floats(channels);
+    head->slot_size   = slot;
+    head->data_offset = page;
+    head->lx          = lx;
+    head->ly          = ly;
+    head->published.store(0, std::memory_order_relaxed);
+    head->alive.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(head->magic, FrameRing::MAGIC, sizeof(head->magic));
+}
+
+/*
+Writes the frame in the next slot, between the two increments of its sequence,
+and makes it the latest one. The oldest frame is overwritten.
+*/
+void Publisher::publish(const Heightfield& frame) {
+    if(!mapping) return;
+    char* const            base = static_cast<char*>(mapping) + head->data_offset + (published%FrameRing::NB_SLOTS)*head->slot_size;
+    FrameRing::slot* const s    = reinterpret_cast<FrameRing::slot*>(base);
+    const uint64_t         seq  = s->sequence.load(std::memory_order_relaxed);
+    s->sequence.store(seq+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->frame = published;
+    s->time  = frame.time;
+    frame.pack(lx, ly, channels, reinterpret_cast<float*>(base + sizeof(FrameRing::slot)));
+    s->sequence.store(seq+2, std::memory_order_release);
+    head->published.store(++published, std::memory_order_release);
+}
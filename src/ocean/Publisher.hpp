@@ -0,0 +1,70 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class publishes the frames of the ocean in a POSIX shared memory, for other
+processes to read the live surface (see FrameRing and RingReader). The frames are
+converted directly into their slot of the shared memory, which is removed when the
+publisher is destroyed. Readers which still map it keep reading the last frames.
+*/
+
+#ifndef PUBLISHERHPP
+#define PUBLISHERHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "shm/FrameRing.hpp"
+#include "Cascade.hpp"
+#include "Heightfield.hpp"
+
+class Publisher {
+
+    public:
+
+        Publisher(Cascade* const, const bool);
+        ~Publisher();
+
+        const uint64_t get_nb_frames() const { return published; }
+
+        void open(const std::string&);
+        void publish(const Heightfield&);
+
+    private:
+
+        const double        lx;           /* actual width of the ocean */
+        const double        ly;           /* actual height of the ocean */
+        const int           nx;           /* nb of x subdivisions */
+        const int           ny;           /* nb of y subdivisions */
+        const int           channels;     /* planes of the frames, see Heightfield::CHANNEL */
+        const std::size_t   frame_size;   /* nb of floats per frame */
+        std::string         name;         /* name of the shared memory */
+        void*               mapping;      /* the shared memory, or nullptr */
+        std::size_t         mapping_size; /* size of the shared memory */
+        FrameRing::header*  head;         /* header of the shared memory */
+        uint64_t            published;    /* nb of frames published */
+
+};
+
+#endif
@@ -0,0 +1,475 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Pyramid.hpp"
+
+/*
+Rebuilds the pyramid from the heights of the given frame, of an ocean of actual
+size p_lx by p_ly. The levels are only allocated again when the grid changes.
+With choppy waves, the horizontal displacements of the vertices are kept too, and
+a cell of the grid may be covered by the triangles of the cells up to rx cells
+away along x and ry along y, rx and ry being the largest displacements of the
+frame in cells. The bounds of the first level are then widened over these
+neighbours, by a sliding window along x then along y, so that they stay
+conservative for the displaced surface.
+*/
+void Pyramid::build(const Heightfield& frame, const double p_lx, const double p_ly) {
+    const int S = Heightfield::STRIDE;
+    lx = p_lx;
+    ly = p_ly;
+    if(wx.empty() || wx[0]!=frame.nx || wy[0]!=frame.ny) {
+        nx = frame.nx;
+        ny = frame.ny;
+        wx.clear();
+        wy.clear();
+        for(int a=nx, b=ny ; ; a=std::max(1, a/2), b=std::max(1, b/2)) {
+            wx.push_back(a);
+            wy.push_back(b);
+            if(a==1 && b==1) break;
+        }
+        mins.resize(wx.size());
+        maxs.resize(wx.size());
+        for(std::size_t l=0 ; l<wx.size() ; l++) {
+            mins[l].resize(wx[l]*wy[l]);
+            maxs[l].resize(wx[l]*wy[l]);
+        }
+        heights.resize((nx+1)*(ny+1));
+        dxs.resize((nx+1)*(ny+1));
+        dzs.resize((nx+1)*(ny+1));
+    }
+    const float cw = lx/nx;
+    const float ch = ly/ny;
+    float       mx = 0;
+    float       mz = 0;
+    for(int y=0 ; y<=ny ; y++) {
+        const float* const v  = frame.row(y);
+        float* const       h  = &heights[(nx+1)*y];
+        float* const       sx = &dxs[(nx+1)*y];
+        float* const       sz = &dzs[(nx+1)*y];
+        for(int x=0 ; x<=nx ; x++) {
+            h[x]  = v[S*x+1];
+            sx[x] = v[S*x]   - cw*x;
+            sz[x] = v[S*x+2] - ch*y;
+            mx    = std::max(mx, std::fabs(sx[x]));
+            mz    = std::max(mz, std::fabs(sz[x]));
+        }
+    }
+    rx = std::min(nx/2, static_cast<int>(ceil(mx/cw)));
+    ry = std::min(ny/2, static_cast<int>(ceil(mz/ch)));
+    for(int y=0 ; y<ny ; y++) {
+        const float* const h0 = &heights[(nx+1)*y];
+        const float* const h1 = h0 + nx+1;
+        float* const       lo = &mins[0][nx*y];
+        float* const       hi = &maxs[0][nx*y];
+        for(int x=0 ; x<nx ; x++) {
+            lo[x] = std::min(std::min(h0[x], h0[x+1]), std::min(h1[x], h1[x+1]));
+            hi[x] = std::max(std::max(h0[x], h0[x+1]), std::max(h1[x], h1[x+1]));
+        }
+    }
+    if(rx>0 || ry>0) {
+        std::vector<float> lo(mins[0]);
+        std::vector<float> hi(maxs[0]);
+        for(int y=0 ; y<ny ; y++) {
+            for(int a=1 ; a<=rx ; a++) {
+                for(int x=0 ; x<nx ; x++) {
+                    mins[0][nx*y + x] = std::min(mins[0][nx*y + x], std::min(lo[nx*y + ((x+a) & (nx-1))], lo[nx*y + ((x-a) & (nx-1))]));
+                    maxs[0][nx*y + x] = std::max(maxs[0][nx*y + x], std::max(hi[nx*y + ((x+a) & (nx-1))], hi[nx*y + ((x-a) & (nx-1))]));
+                }
+            }
+        }
+        lo = mins[0];
+        hi = maxs[0];
+        for(int b=1 ; b<=ry ; b++) {
+            for(int y=0 ; y<ny ; y++) {
+                const float* const lo0 = &lo[nx*((y+b) & (ny-1))];
+                const float* const lo1 = &lo[nx*((y-b) & (ny-1))];
+                const float* const hi0 = &hi[nx*((y+b) & (ny-1))];
+                const float* const hi1 = &hi[nx*((y-b) & (ny-1))];
+                for(int x=0 ; x<nx ; x++) {
+                    mins[0][nx*y + x] = std::min(mins[0][nx*y + x], std::min(lo0[x], lo1[x]));
+                    maxs[0][nx*y + x] = std::max(maxs[0][nx*y + x], std::max(hi0[x], hi1[x]));
+                }
+            }
+        }
+    }
+    for(std::size_t l=1 ; l<wx.size() ; l++) {
+        const int fx = wx[l-1]/wx[l];
+        const int fy = wy[l-1]/wy[l];
+        for(int j=0 ; j<wy[l] ; j++) {
+            const float* const lo0 = &mins[l-1][wx[l-1]*fy*j];
+            const float* const lo1 = lo0 + wx[l-1]*(fy-1);
+            const float* const hi0 = &maxs[l-1][wx[l-1]*fy*j];
+            const float* const hi1 = hi0 + wx[l-1]*(fy-1);
+            float* const       lo  = &mins[l][wx[l]*j];
+            float* const       hi  = &maxs[l][wx[l]*j];
+            if(fx==2) {
+                for(int i=0 ; i<wx[l] ; i++) {
+                    lo[i] = std::min(std::min(lo0[2*i], lo0[2*i+1]), std::min(lo1[2*i], lo1[2*i+1]));
+                    hi[i] = std::max(std::max(hi0[2*i], hi0[2*i+1]), std::max(hi1[2*i], hi1[2*i+1]));
+                }
+            }
+            else {
+                for(int i=0 ; i<wx[l] ; i++) {
+                    lo[i] = std::min(lo0[i], lo1[i]);
+                    hi[i] = std::max(hi0[i], hi1[i]);
+                }
+            }
+        }
+    }
+}
+
+/*
+Returns the distance from the origin o of a ray of direction d, a unit vector, to
+the first point of the ray on or under the surface, or -1 if there is none within
+range. The ray is first cut to the band between the lowest and the highest point
+of the ocean. The part in the band crosses the copies of the ocean, or the tiles
+of the tiling if one is given. Inside the border of a tile, the ray is moved into
+the frame by the transform of the tile, and the frame is searched with the
+pyramid. In the border, the heights of up to four transforms are blended, with
+weights that sum to 2 at most, so the band is twice as wide, and the ray is
+marched instead.
+*/
+const double Pyramid::intersect(const double* const o, const double* const d, const double range, const Tiling* const tiling) const {
+    const double lo  = tiling ? std::min(get_min(), 2*get_min()) : get_min();
+    const double hi  = tiling ? std::max(get_max(), 2*get_max()) : get_max();
+    double       t0  = 0;
+    double       t1  = range;
+    double       hit = -1;
+    if(o[1]<=lo) return 0;
+    if(d[1]<0) {
+        t0 = std::max(t0, (hi-o[1])/d[1]);
+        t1 = std::min(t1, (lo-o[1])/d[1]);
+    }
+    else if(o[1]>hi) {
+        return -1;
+    }
+    else if(d[1]>0) {
+        t1 = std::min(t1, (hi-o[1])/d[1]);
+    }
+    if(!tiling) return walk(o, d, t0, t1, &hit) ? hit : -1;
+    const double bx = lx/nx*tiling->get_width_x();
+    const double bz = ly/ny*tiling->get_width_y();
+    int          i  = static_cast<int>(floor((o[0] + t0*d[0])/lx));
+    int          j  = static_cast<int>(floor((o[2] + t0*d[2])/ly));
+    for(double t=t0 ; t<t1 ; ) {
+        const double            ex   = d[0]>0 ? ((i+1)*lx - o[0])/d[0] : (d[0]<0 ? (i*lx - o[0])/d[0] : t1);
+        const double            ez   = d[2]>0 ? ((j+1)*ly - o[2])/d[2] : (d[2]<0 ? (j*ly - o[2])/d[2] : t1);
+        const double            e    = std::min(t1, std::min(ex, ez));
+        const double            p[3] = {o[0] - i*lx, o[1], o[2] - j*ly};
+        const Tiling::Transform tr   = tiling->transform(i, j);
+        double                  a    = t;
+        double                  b    = e;
+        slab(p[0], d[0], bx, lx-bx, &a, &b);
+        slab(p[2], d[2], bz, ly-bz, &a, &b);
+        if(a<b) {
+            const double q[3] = {tr.flip_x ? tr.ox*lx/nx - p[0] : p[0] + tr.ox*lx/nx, o[1], tr.flip_z ? tr.oy*ly/ny - p[2] : p[2] + tr.oy*ly/ny};
+            const double r[3] = {tr.flip_x ? -d[0] : d[0], d[1], tr.flip_z ? -d[2] : d[2]};
+            if(march(*tiling, o, d, t, a, &hit)) return hit;
+            if(walk(q, r, a, b, &hit))           return hit;
+            if(march(*tiling, o, d, b, e, &hit)) return hit;
+        }
+        else if(march(*tiling, o, d, t, e, &hit)) {
+            return hit;
+        }
+        if(ex<=ez) i += d[0]>0 ? 1 : -1;
+        if(ez<=ex) j += d[2]>0 ? 1 : -1;
+        t = e;
+    }
+    return -1;
+}
+
+/*
+Searches the ray between the distances t0 and t1 for its first hit with the
+periodic ocean: the ray crosses the copies of the ocean one after the other, each
+being searched from the root of the pyramid.
+*/
+const bool Pyramid::walk(const double* const o, const double* const d, const double t0, const double t1, double* const hit) const {
+    int i = static_cast<int>(floor((o[0] + t0*d[0])/lx));
+    int j = static_cast<int>(floor((o[2] + t0*d[2])/ly));
+    for(double t=t0 ; t<t1 ; ) {
+        const double ex = d[0]>0 ? ((i+1)*lx - o[0])/d[0] : (d[0]<0 ? (i*lx - o[0])/d[0] : t1);
+        const double ez = d[2]>0 ? ((j+1)*ly - o[2])/d[2] : (d[2]<0 ? (j*ly - o[2])/d[2] : t1);
+        const double e  = std::min(t1, std::min(ex, ez));
+        const double p[3] = {o[0] - i*lx, o[1], o[2] - j*ly};
+        if(descend(static_cast<int>(wx.size())-1, 0, 0, p, d, t, e, hit)) return true;
+        if(ex<=ez) i += d[0]>0 ? 1 : -1;
+        if(ez<=ex) j += d[2]>0 ? 1 : -1;
+        t = e;
+    }
+    return false;
+}
+
+/*
+Returns the height of the frame at the actual position (x, z), on the two
+triangles of its cell as for the rays, the ocean being periodic. With choppy
+waves, the surface point seen at (x, z) comes from the point p of the grid such
+that p + D(p) = (x, z), D being the displacement interpolated between the vertices,
+which is found with a few fixed-point iterations as for the probes.
+*/
+const double Pyramid::height(const double x, const double z) const {
+    double u = x*nx/lx;
+    double v = z*ny/ly;
+    for(int k=0 ; k<(rx>0 || ry>0 ? Ocean::CHOPPY_ITERATIONS : 0) ; k++) {
+        const double       fu = floor(u);
+        const double       fv = floor(v);
+        const double       a  = u-fu;
+        const double       b  = v-fv;
+        const int          c  = (nx+1)*(static_cast<int>(fv) & (ny-1)) + (static_cast<int>(fu) & (nx-1));
+        const float* const s0 = &dxs[c];
+        const float* const s1 = s0 + nx+1;
+        const float* const t0 = &dzs[c];
+        const float* const t1 = t0 + nx+1;
+        u = (x - ((1-b)*((1-a)*s0[0] + a*s0[1]) + b*((1-a)*s1[0] + a*s1[1])))*nx/lx;
+        v = (z - ((1-b)*((1-a)*t0[0] + a*t0[1]) + b*((1-a)*t1[0] + a*t1[1])))*ny/ly;
+    }
+    const double       fu = floor(u);
+    const double       fv = floor(v);
+    const double       a  = u-fu;
+    const double       b  = v-fv;
+    const float* const h0 = &heights[(nx+1)*(static_cast<int>(fv) & (ny-1)) + (static_cast<int>(fu) & (nx-1))];
+    const float* const h1 = h0 + nx+1;
+    return a>=b ? h0[0] + a*(h0[1]-h0[0]) + b*(h1[1]-h0[1]) : h0[0] + b*(h1[0]-h0[0]) + a*(h1[1]-h1[0]);
+}
+
+/*
+Searches the ray between the distances t0 and t1 for its first hit with the tiles,
+where their borders blend several transforms of the frame. The height of the ray
+over the blended surface is sampled MARCH times per cell crossed, and the first
+sample on or under the surface is refined by bisection with the previous one,
+then by a linear interpolation.
+*/
+const bool Pyramid::march(const Tiling& tiling, const double* const o, const double* const d, const double t0, const double t1, double* const hit) const {
+    const double h  = sqrt(d[0]*d[0] + d[2]*d[2]);
+    const int    n  = h>0 ? std::max(1, static_cast<int>(ceil((t1-t0)*h*MARCH/std::min(lx/nx, ly/ny)))) : 1;
+    double       ta = t0;
+    double       fa = o[1] + t0*d[1] - blended(tiling, o[0] + t0*d[0], o[2] + t0*d[2]);
+    if(t1<=t0) return false;
+    if(fa<=0) {
+        *hit = t0;
+        return true;
+    }
+    for(int k=1 ; k<=n ; k++) {
+        double tb = t0 + (t1-t0)*k/n;
+        double fb = o[1] + tb*d[1] - blended(tiling, o[0] + tb*d[0], o[2] + tb*d[2]);
+        if(fb>0) {
+            ta = tb;
+            fa = fb;
+            continue;
+        }
+        for(int r=0 ; r<REFINE ; r++) {
+            const double tm = (ta+tb)/2;
+            const double fm = o[1] + tm*d[1] - blended(tiling, o[0] + tm*d[0], o[2] + tm*d[2]);
+            if(fm>0) {
+                ta = tm;
+                fa = fm;
+            }
+            else {
+                tb = tm;
+                fb = fm;
+            }
+        }
+        *hit = ta + (tb-ta)*fa/(fa-fb);
+        return true;
+    }
+    return false;
+}
+
+/*
+Returns the height of the tiles at the actual position (x, z), blending the
+heights of the frame at the positions given by the tiling.
+*/
+const double Pyramid::blended(const Tiling& tiling, const double x, const double z) const {
+    double    sx[4];
+    double    sz[4];
+    float     w[4];
+    double    sum = 0;
+    const int n   = tiling.sources(x, z, sx, sz, w);
+    for(int k=0 ; k<n ; k++) sum += w[k]*height(sx[k], sz[k]);
+    return sum;
+}
+
+/*
+Cuts the range [u0, u1] of a ray to the part where o + u.d is between a and b.
+The range is left empty if there is no such part.
+*/
+inline void Pyramid::slab(const double o, const double d, const double a, const double b, double* const u0, double* const u1) {
+    if(d>0) {
+        *u0 = std::max(*u0, (a-o)/d);
+        *u1 = std::min(*u1, (b-o)/d);
+    }
+    else if(d<0) {
+        *u0 = std::max(*u0, (b-o)/d);
+        *u1 = std::min(*u1, (a-o)/d);
+    }
+    else if(o<a || o>b) {
+        *u1 = *u0 - 1;
+    }
+}
+
+/*
+Searches the cell (i, j) of the level l for the first hit of the ray between the
+distances s0 and s1, the ray being given relative to the first corner of the
+ocean. The cell is skipped when the ray passes over its highest point, and is hit
+where the ray enters it when the ray is already under its lowest point. Otherwise
+its cells of the level below are searched in the order the ray crosses them: the
+ray crosses three of the four at most, and the first one and the last one are set
+by the direction of the ray.
+*/
+const bool Pyramid::descend(const int l, const int i, const int j, const double* const o, const double* const d, const double s0, const double s1, double* const hit) const {
+    const double cw = lx/wx[l];
+    const double ch = ly/wy[l];
+    double       u0 = s0;
+    double       u1 = s1;
+    slab(o[0], d[0], i*cw, (i+1)*cw, &u0, &u1);
+    slab(o[2], d[2], j*ch, (j+1)*ch, &u0, &u1);
+    if(u0>u1) return false;
+    const double y0 = o[1] + u0*d[1];
+    const double y1 = o[1] + u1*d[1];
+    if(std::min(y0, y1)>maxs[l][wx[l]*j + i]) return false;
+    if(std::max(y0, y1)<=mins[l][wx[l]*j + i]) {
+        *hit = u0;
+        return true;
+    }
+    if(l==0) return cell(i, j, o, d, u0, u1, hit);
+    const int fx = wx[l-1]/wx[l];
+    const int fy = wy[l-1]/wy[l];
+    for(int b=0 ; b<fy ; b++) {
+        for(int a=0 ; a<fx ; a++) {
+            const int ci = fx*i + (d[0]<0 ? fx-1-a : a);
+            const int cj = fy*j + (d[2]<0 ? fy-1-b : b);
+            if(descend(l-1, ci, cj, o, d, u0, u1, hit)) return true;
+        }
+    }
+    return false;
+}
+
+/*
+Intersects the ray between the distances u0 and u1 with the two triangles of the
+cell (i, j) of the grid, on both sides of its diagonal u = v, u and v being the
+coordinates in the cell. The height of the ray over a triangle is linear along
+the ray, so the hit is found from its values at the ends of each piece.
+With choppy waves, the ray is intersected with the displaced triangles of all the
+cells that may cover the cell instead, and the first hit within [u0, u1] is kept.
+*/
+const bool Pyramid::cell(const int i, const int j, const double* const o, const double* const d, const double u0, const double u1, double* const hit) const {
+    if(rx>0 || ry>0) return displaced(i, j, o, d, u0, u1, hit);
+    const float* const h0    = &heights[(nx+1)*j + i];
+    const float* const h1    = h0 + nx+1;
+    const double       pu    = (o[0] - i*lx/nx)*nx/lx;
+    const double       pv    = (o[2] - j*ly/ny)*ny/ly;
+    const double       du    = d[0]*nx/lx;
+    const double       dv    = d[2]*ny/ly;
+    double             ts[3] = {u0, u1, u1};
+    if(du!=dv) {
+        const double s = (pv-pu)/(du-dv);
+        if(s>u0 && s<u1) ts[1] = s;
+    }
+    for(int k=0 ; k<2 && ts[k]<ts[k+1] ; k++) {
+        const double m     = (ts[k] + ts[k+1])/2;
+        const bool   upper = pu + m*du>=pv + m*dv;
+        double       f[2];
+        for(int e=0 ; e<2 ; e++) {
+            const double t = ts[k+e];
+            const double u = pu + t*du;
+            const double v = pv + t*dv;
+            const double h = upper ? h0[0] + u*(h0[1]-h0[0]) + v*(h1[1]-h0[1]) : h0[0] + v*(h1[0]-h0[0]) + u*(h1[1]-h1[0]);
+            f[e] = o[1] + t*d[1] - h;
+        }
+        if(f[0]<=0) {
+            *hit = ts[k];
+            return true;
+        }
+        if(f[1]<=0) {
+            *hit = ts[k] + (ts[k+1]-ts[k])*f[0]/(f[0]-f[1]);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+Intersects the ray between the distances u0 and u1 with the displaced triangles of
+the cells within rx and ry of the cell (i, j), the ocean being periodic. The cells
+whose displaced corners cannot reach the part of the ray over the cell are
+skipped, and the first hit of the others is kept.
+*/
+const bool Pyramid::displaced(const int i, const int j, const double* const o, const double* const d, const double u0, const double u1, double* const hit) const {
+    const double cw    = lx/nx;
+    const double ch    = ly/ny;
+    const double x0    = std::min(o[0] + u0*d[0], o[0] + u1*d[0]);
+    const double x1    = std::max(o[0] + u0*d[0], o[0] + u1*d[0]);
+    const double z0    = std::min(o[2] + u0*d[2], o[2] + u1*d[2]);
+    const double z1    = std::max(o[2] + u0*d[2], o[2] + u1*d[2]);
+    double       first = u1;
+    bool         found = false;
+    for(int b=j-ry ; b<=j+ry ; b++) {
+        for(int a=i-rx ; a<=i+rx ; a++) {
+            const int    c    = (nx+1)*(b & (ny-1)) + (a & (nx-1));
+            const int    k[4] = {c, c+1, c+nx+2, c+nx+1};
+            const int    e[4] = {0, 1, 1, 0};
+            const int    f[4] = {0, 0, 1, 1};
+            double       p[4][3];
+            double       lo[2] = {x1, z1};
+            double       hi[2] = {x0, z0};
+            for(int q=0 ; q<4 ; q++) {
+                p[q][0] = (a + e[q])*cw + dxs[k[q]];
+                p[q][1] = heights[k[q]];
+                p[q][2] = (b + f[q])*ch + dzs[k[q]];
+                lo[0]   = std::min(lo[0], p[q][0]);
+                hi[0]   = std::max(hi[0], p[q][0]);
+                lo[1]   = std::min(lo[1], p[q][2]);
+                hi[1]   = std::max(hi[1], p[q][2]);
+            }
+            if(lo[0]>x1 || hi[0]<x0 || lo[1]>z1 || hi[1]<z0) continue;
+            found = triangle(p[0], p[1], p[2], o, d, u0, &first) || found;
+            found = triangle(p[0], p[2], p[3], o, d, u0, &first) || found;
+        }
+    }
+    if(found) *hit = first;
+    return found;
+}
+
+/*
+Intersects the ray with the triangle (a, b, c), and sets t1 to the distance of the
+hit if it is between t0 and t1. Returns true if so.
+*/
+inline const bool Pyramid::triangle(const double* const a, const double* const b, const double* const c, const double* const o, const double* const d, const double t0, double* const t1) {
+    const double e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+    const double e2[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+    const double p[3]  = {d[1]*e2[2] - d[2]*e2[1], d[2]*e2[0] - d[0]*e2[2], d[0]*e2[1] - d[1]*e2[0]};
+    const double det   = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+    if(det==0) return false;
+    const double s[3]  = {o[0]-a[0], o[1]-a[1], o[2]-a[2]};
+    const double u     = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2])/det;
+    if(u<0 || u>1) return false;
+    const double q[3]  = {s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0]};
+    const double v     = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2])/det;
+    if(v<0 || u+v>1) return false;
+    const double t     = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2])/det;
+    if(t<t0 || t>*t1) return false;
+    *t1 = t;
+    return true;
+}
@@ -0,0 +1,98 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class bounds the surface of an ocean frame for the ray casts and the culling.
+It keeps the heights of the frame on its regular grid, and a pyramid of levels of
+cells: each cell of the first level holds the lowest and the highest of its four
+corners, and each cell of the next levels the lowest and the highest of the two or
+four cells it covers, up to a single cell for the whole ocean. The levels are
+rebuilt from each frame in loops that the compiler can vectorize.
+A ray walks down the pyramid from the root, skips the cells whose bounds it passes
+over, and visits the other ones in their order along the ray, so that it stops at
+the first hit after a few dozen cells instead of scanning the grid. The ocean being
+periodic, a long ray crosses its copies one after the other, or the tiles of a
+Tiling, whose borders are marched. Each cell of the grid
+is cut into two triangles along the diagonal from its first corner, and the ray is
+intersected with them exactly. With choppy waves, the triangles are moved by the
+horizontal displacements of their corners: the bounds of the first level are
+widened over the cells that the largest displacement of the frame can reach, and
+the ray is intersected with the displaced triangles of these cells.
+*/
+
+#ifndef PYRAMIDHPP
+#define PYRAMIDHPP
+
+#include <vector>
+
+#include "Heightfield.hpp"
+#include "Tiling.hpp"
+
+class Pyramid {
+
+    public:
+
+        Pyramid() : lx(0), ly(0), nx(0), ny(0), rx(0), ry(0) {}
+        ~Pyramid() {}
+
+        void         build(const Heightfield&, const double, const double);
+        const double intersect(const double* const, const double* const, const double, const Tiling* const=nullptr) const;
+
+        const int   get_nb_levels() const { return static_cast<int>(mins.size()); }
+        const float get_min()       const { return mins.back()[0]; }
+        const float get_max()       const { return maxs.back()[0]; }
+
+    private:
+
+        static const int MARCH  = 4;   /* nb of samples per cell crossed in the border of a tile */
+        static const int REFINE = 8;   /* nb of bisections of a hit in the border of a tile */
+
+        const bool   walk(const double* const, const double* const, const double, const double, double* const) const;
+        const double height(const double, const double) const;
+        const bool   march(const Tiling&, const double* const, const double* const, const double, const double, double* const) const;
+        const double blended(const Tiling&, const double, const double) const;
+        const bool   descend(const int, const int, const int, const double* const, const double* const, const double, const double, double* const) const;
+        const bool   cell(const int, const int, const double* const, const double* const, const double, const double, double* const) const;
+        const bool   displaced(const int, const int, const double* const, const double* const, const double, const double, double* const) const;
+
+        static inline const bool triangle(const double* const, const double* const, const double* const, const double* const, const double* const, const double, double* const);
+
+        static inline void slab(const double, const double, const double, const double, double* const, double* const);
+
+        double                          lx;        /* actual width of the ocean */
+        double                          ly;        /* actual height of the ocean */
+        int                             nx;        /* nb of x subdivisions of the frame */
+        int                             ny;        /* nb of y subdivisions of the frame */
+        int                             rx;        /* nb of cells along x that the displacements of the frame can cross */
+        int                             ry;        /* nb of cells along y that the displacements of the frame can cross */
+        std::vector<float>              heights;   /* (nx+1)*(ny+1) heights of the frame, row after row */
+        std::vector<float>              dxs;       /* displacement along x of each vertex of the frame */
+        std::vector<float>              dzs;       /* displacement along z of each vertex of the frame */
+        std::vector<int>                wx;        /* nb of cells of each level along x, from the grid to the root */
+        std::vector<int>                wy;        /* nb of cells of each level along y */
+        std::vector<std::vector<float>> mins;      /* lowest height of each cell of each level, row after row */
+        std::vector<std::vector<float>> maxs;      /* highest height of each cell of each level, row after row */
+
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Recorder.hpp"
+
+/*
+Initializes the variables. The displacements are recorded if the ocean is choppy,
+and the normals if asked. The frames are compressed if the maximum error is not
+zero, by the threads of the given pool, which is the pool of the host computing
+the oceans. Nothing is written before open() is called.
+*/
+Recorder::Recorder(Cascade* const p_ocean, ThreadPool* const p_pool, const bool p_normals, const double p_max_error, const Codec::ENTROPY p_entropy) :
+    lx(p_ocean->get_lx()),
+    ly(p_ocean->get_ly()),
+    nx(p_ocean->get_frame_nx()),
+    ny(p_ocean->get_frame_ny()),
+    channels(Heightfield::HEIGHTS | (p_ocean->get_ocean(0)->get_choppiness()!=0 ? Heightfield::DISPLACEMENTS : 0) | (p_normals ? Heightfield::NORMALS : 0)),
+    nb_floats(Heightfield::nb_floats(channels)),
+    frame_size(static_cast<std::size_t>(nb_floats)*(nx+1)*(ny+1)),
+    page_size(static_cast<uint64_t>(sysconf(_SC_PAGESIZE))),
+    max_error(p_max_error),
+    entropy(p_entropy),
+    alignment(p_max_error>0 ? 8 : page_size),
+    codec(nullptr),
+    pool(p_pool),
+    fd(-1),
+    end(0),
+    stop(false),
+    failed(false) {
+}
+
+/*
+Closes the recording if it was not, ignoring the errors.
+*/
+Recorder::~Recorder() {
+    try {
+        close();
+    }
+    catch(const std::exception&) {
+    }
+    delete codec;
+}
+
+/*
+Returns the header of the file, with the frames recorded so far.
+*/
+const Recorder::header Recorder::make_header() const {
+    header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "FFTFRAME", sizeof(h.magic));
+    h.version      = 2;
+    h.channels     = channels;
+    h.nx           = nx;
+    h.ny           = ny;
+    h.nb_floats    = nb_floats;
+    h.alignment    = static_cast<uint32_t>(alignment);
+    h.coding       = max_error<=0 ? RAW : entropy==Codec::ZSTD ? ZSTD : RICE;
+    h.key_interval = max_error<=0 ? 0 : Codec::KEY_INTERVAL;
+    h.nb_frames    = index.size();
+    h.index_offset = index.empty() ? 0 : end;
+    h.lx           = lx;
+    h.ly           = ly;
+    h.max_error    = max_error;
+    return h;
+}
+
+/*
+Creates the file, writes a header without any frame, and starts the writer,
+which compresses the frames, if asked, with the given pool.
+*/
+void Recorder::open(const std::string& p_file) {
+    file = p_file;
+    fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd<0) throw std::runtime_error("cannot create the recording file " + file);
+    const header h = make_header();
+    if(!write_at(&h, sizeof(h), 0)) {
+        ::close(fd);
+        fd = -1;
+        throw std::runtime_error("cannot write the recording file " + file);
+    }
+    end = page_size;
+    if(max_error>0) codec = new Codec(nx, ny, nb_floats, max_error, entropy);
+    buffers.assign(QUEUE_SIZE, std::vector<float>(frame_size));
+    for(int i=0 ; i<QUEUE_SIZE ; i++) free_buffers.push_back(i);
+    writer = std::thread(&Recorder::write_loop, this);
+}
+
+/*
+Writes n bytes at the given offset of the file. Returns false on error.
+*/
+const bool Recorder::write_at(const void* const data, const std::size_t n, const uint64_t offset) const {
+    const char* bytes = static_cast<const char*>(data);
+    std::size_t done  = 0;
+    while(done<n) {
+        const ssize_t written = pwrite(fd, bytes + done, n - done, static_cast<off_t>(offset + done));
+        if(written<=0) return false;
+        done += static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+/*
+Queues the frame to be written after the previous ones. This only waits when
+the writer is QUEUE_SIZE frames late. Nothing is recorded after a write error.
+*/
+void Recorder::record(const Heightfield& frame) {
+    if(fd<0) return;
+    int buffer;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        freed.wait(lock, [this] { return failed || !free_buffers.empty(); });
+        if(failed) return;
+        buffer = free_buffers.back();
+        free_buffers.pop_back();
+    }
+    frame.pack(lx, ly, channels, buffers[buffer].data());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({buffer, frame.time});
+    }
+    ready.notify_one();
+}
+
+/*
+Loop of the writer thread: compresses and writes the queued frames in order
+until close() is called, and adds them to the index.
+*/
+void Recorder::write_loop() {
+    while(true) {
+        job j;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stop || !pending.empty(); });
+            if(pending.empty()) return;
+            j = pending.front();
+            pending.pop_front();
+        }
+        const void* data = buffers[j.buffer].data();
+        std::size_t size = sizeof(float)*frame_size;
+        if(codec) {
+            codec->encode(buffers[j.buffer].data(), &coded, pool);
+            data = coded.data();
+            size = coded.size();
+        }
+        const bool ok = write_at(data, size, end);
+        if(ok) {
+            const entry e = {j.time, end, size};
+            index.push_back(e);
+            end += (size + alignment - 1)/alignment*alignment;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push_back(j.buffer);
+            if(!ok) failed = true;
+        }
+        freed.notify_one();
+    }
+}
+
+/*
+Waits for the queued frames to be written, then writes the index after the
+last frame and completes the header. Throws if any write failed.
+*/
+void Recorder::close() {
+    if(fd<0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    ready.notify_one();
+    writer.join();
+    const header h  = make_header();
+    bool         ok = !failed;
+    if(ok && !index.empty()) ok = write_at(index.data(), sizeof(entry)*index.size(), end);
+    if(ok) ok = write_at(&h, sizeof(h), 0);
+    if(::close(fd)!=0) ok = false;
+    fd = -1;
+    if(!ok) throw std::runtime_error("cannot write the recording file " + file);
+}
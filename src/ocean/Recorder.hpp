@@ -0,0 +1,141 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class records the frames of the ocean to a binary file, for offline rendering
+or as training data. The file starts with a header page, followed by the frames, each
+starting on a page boundary, and ends with an index giving the time, the offset and
+the size of every frame. A reader can thus map the file and reach any frame directly.
+A frame holds the channels of the (nx+1)*(ny+1) vertices one after the other, as floats
+and row after row: the heights, then the horizontal displacements along x and z if the
+ocean is choppy, then the three coordinates of the normals if they are requested.
+The frames can also be compressed with a bounded error by a Codec. They then have
+different sizes, and are only aligned on 8 bytes.
+The number of frames and the offset of the index are only written in the header when
+the recording is closed, so a file still being written, or left broken, has no frame.
+The frames are converted by the calling thread, and compressed and written by a background
+thread, so the simulation only waits when all the buffers of the queue are full. The bands
+of a frame are compressed concurrently by the pool of threads of the host, which the writer
+shares with the oceans: while they use it, the writer compresses a frame on its own.
+*/
+
+#ifndef RECORDERHPP
+#define RECORDERHPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel/ThreadPool.hpp"
+#include "Cascade.hpp"
+#include "Codec.hpp"
+#include "Heightfield.hpp"
+
+class Recorder {
+
+    public:
+
+        enum CODING {RAW, RICE, ZSTD};   /* coding of the frames */
+
+        struct header {
+            char     magic[8];       /* "FFTFRAME" without the final zero */
+            uint32_t version;        /* version of the file format */
+            uint32_t channels;       /* channels of the frames, see Heightfield::CHANNEL */
+            uint32_t nx;             /* nb of x subdivisions, the frames have nx+1 columns */
+            uint32_t ny;             /* nb of y subdivisions, the frames have ny+1 rows */
+            uint32_t nb_floats;      /* nb of floats per vertex */
+            uint32_t alignment;      /* alignment of the frames, in bytes */
+            uint32_t coding;         /* coding of the frames, see CODING */
+            uint32_t key_interval;   /* nb of frames between two key frames if compressed */
+            uint64_t nb_frames;      /* nb of frames in the index, zero until the recording is closed */
+            uint64_t index_offset;   /* offset of the index in the file, in bytes */
+            double   lx;             /* actual width of the ocean */
+            double   ly;             /* actual height of the ocean */
+            double   max_error;      /* maximum absolute error of the values if compressed */
+        };
+
+        struct entry {
+            double   time;           /* simulation time of the frame, in seconds */
+            uint64_t offset;         /* offset of the frame in the file, in bytes */
+            uint64_t size;           /* size of the frame, in bytes */
+        };
+
+        Recorder(Cascade* const, ThreadPool* const, const bool, const double=0, const Codec::ENTROPY=Codec::RICE);
+        ~Recorder();
+
+        const std::size_t get_nb_frames() const { return index.size(); }
+        const uint64_t    get_size()      const { return end; }
+
+        void open(const std::string&);
+        void record(const Heightfield&);
+        void close();
+
+    private:
+
+        static const int QUEUE_SIZE = 8;   /* nb of frames waiting to be written at most */
+
+        struct job {
+            int      buffer;         /* buffer holding the frame */
+            double   time;           /* simulation time of the frame, in seconds */
+        };
+
+        const header make_header() const;
+        const bool   write_at(const void* const, const std::size_t, const uint64_t) const;
+        void         write_loop();
+
+        const double                    lx;            /* actual width of the ocean */
+        const double                    ly;            /* actual height of the ocean */
+        const int                       nx;            /* nb of x subdivisions */
+        const int                       ny;            /* nb of y subdivisions */
+        const int                       channels;      /* channels of the frames, see Heightfield::CHANNEL */
+        const int                       nb_floats;     /* nb of floats per vertex */
+        const std::size_t               frame_size;    /* nb of floats per frame */
+        const uint64_t                  page_size;     /* size of the header */
+        const double                    max_error;     /* maximum absolute error if compressed, else zero */
+        const Codec::ENTROPY            entropy;       /* coding of the compressed frames */
+        const uint64_t                  alignment;     /* alignment of the frames, in bytes */
+        Codec*                          codec;         /* compression of the frames, or nullptr */
+        ThreadPool* const               pool;          /* threads compressing the bands of a frame, shared with the oceans */
+        std::vector<unsigned char>      coded;         /* compressed frame being written */
+        std::string                     file;          /* path of the recording */
+        int                             fd;            /* file descriptor, or -1 */
+        uint64_t                        end;           /* offset of the next frame, moved by the writer */
+        std::vector<entry>              index;         /* frames written so far, filled by the writer */
+        std::vector<std::vector<float>> buffers;       /* frames waiting to be written */
+        std::vector<int>                free_buffers;  /* buffers which can be filled */
+        std::deque<job>                 pending;       /* frames to write, in order */
+        std::mutex                      mutex;         /* protects the variables below */
+        std::condition_variable         ready;         /* signals a frame to write, or the end */
+        std::condition_variable         freed;         /* signals a buffer written */
+        bool                            stop;          /* tells the writer to exit once the queue is empty */
+        bool                            failed;        /* true if a write failed */
+        std::thread                     writer;        /* background writer thread */
+
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Simulation.hpp"
+
+/*
+Initializes the variables and computes the first frame, so that
+the rendering has something to draw before the thread starts.
+*/
+Simulation::Simulation(Cascade* const p_ocean, const double p_rate, LoopCache* const p_cache, const double p_start, Publisher* const p_publisher) :
+    ocean(p_ocean),
+    cache(p_cache),
+    publisher(p_publisher),
+    rate(p_cache ? p_cache->get_rate() : p_rate),
+    running(false),
+    initial_time(p_start),
+    start_time(clock::now()) {
+    step();
+}
+
+/*
+Stops the simulation thread.
+*/
+Simulation::~Simulation() {
+    stop();
+}
+
+/*
+Starts the simulation thread.
+*/
+void Simulation::start() {
+    if(running) return;
+    running = true;
+    thread  = std::thread(&Simulation::loop, this);
+}
+
+/*
+Asks the simulation thread to stop and waits for it.
+*/
+void Simulation::stop() {
+    running = false;
+    if(thread.joinable()) thread.join();
+}
+
+/*
+Computes the frames at the expected rate until stop() is called.
+If a frame takes too long, the next one starts right away.
+*/
+void Simulation::loop() {
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0/rate));
+    clock::time_point     next   = clock::now();
+    while(running) {
+        step();
+        next += period;
+        const clock::time_point now = clock::now();
+        if(next<now) next = now;
+        else         std::this_thread::sleep_until(next);
+    }
+}
+
+/*
+Returns the start time plus the time elapsed since the creation of the
+simulation, in seconds. This is the clock used for the frames.
+*/
+const double Simulation::get_time() const {
+    return initial_time + std::chrono::duration<double>(clock::now() - start_time).count();
+}
+
+/*
+Computes the ocean at the current time, or reads it from the loop cache,
+and publishes the frame for the rendering and the other processes.
+*/
+void Simulation::step() {
+    const double t = get_time();
+    if(cache) {
+        cache->fill_heightfield(t, frames.get_back());
+    }
+    else {
+        ocean->main_computation(t);
+        ocean->fill_heightfield(t, frames.get_back());
+    }
+    if(publisher) publisher->publish(*frames.get_back());
+    frames.publish();
+}
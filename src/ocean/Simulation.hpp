@@ -0,0 +1,84 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class runs the ocean simulation in its own thread, so that the cost of the
+FFTs does not add to the rendering latency. The frames are produced at the given
+rate into a lock-free triple buffer, and the rendering always gets the latest
+complete one with latest(), without ever waiting for the simulation.
+The simulation rate does not need to match the display rate: the rendering can
+interpolate between the two latest frames, and it then displays the surface one
+simulation period late, at get_time() - 1/get_rate().
+When a loop cache is given, the frames are read from it instead of being computed,
+at the rate of the cache. The simulation can start at any time, to resume a saved one.
+Every frame can also be published for other processes.
+*/
+
+#ifndef SIMULATIONHPP
+#define SIMULATIONHPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "parallel/TripleBuffer.hpp"
+#include "Cascade.hpp"
+#include "Heightfield.hpp"
+#include "LoopCache.hpp"
+#include "Publisher.hpp"
+
+class Simulation {
+
+    public:
+
+        Simulation(Cascade* const, const double, LoopCache* const, const double=0, Publisher* const=nullptr);
+        ~Simulation();
+
+        Cascade*           get_ocean() const { return ocean; }
+        const Heightfield* latest() { return frames.acquire(); }
+        const double       get_rate() const { return rate; }
+        const double       get_time() const;
+
+        void start();
+        void stop();
+
+    private:
+
+        typedef std::chrono::steady_clock clock;
+
+        void loop();
+        void step();
+
+        Cascade* const            ocean;        /* the simulated ocean */
+        LoopCache* const          cache;        /* precomputed frames, or nullptr */
+        Publisher* const          publisher;    /* publisher of the frames, or nullptr */
+        const double              rate;         /* nb of frames computed per second */
+        TripleBuffer<Heightfield> frames;       /* frames shared with the rendering */
+        std::thread               thread;       /* simulation thread */
+        std::atomic<bool>         running;      /* false to stop the simulation thread */
+        const double              initial_time; /* time of the simulation when it is created, in seconds */
+        clock::time_point         start_time;   /* time origin of the simulation */
+
+};
+
+#endif
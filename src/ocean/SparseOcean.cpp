@@ -0,0 +1,167 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "SparseOcean.hpp"
+
+namespace {
+
+    /*
+    Computes the sine and cosine of theta with a reduction to [-pi/4 ; pi/4] and
+    Taylor polynomials, precise to about 1e-6 for the phases met in the ocean.
+    There is no call and no branch, so loops calling it can be vectorized.
+    */
+    inline void fast_sincos(const float theta, float* const s, float* const c) {
+        const float j  = floorf(theta*static_cast<float>(2/M_PI) + 0.5f);
+        const float r  = (theta - j*1.5703125f) - j*4.83826794897e-4f;
+        const float r2 = r*r;
+        const float sr = r*(1 + r2*(-1.0f/6 + r2*(1.0f/120 + r2*(-1.0f/5040))));
+        const float cr = 1 + r2*(-0.5f + r2*(1.0f/24 + r2*(-1.0f/720 + r2*(1.0f/40320))));
+        const int   q  = static_cast<int>(j) & 3;
+        const float ss = q&1 ? cr : sr;
+        const float cc = q&1 ? sr : cr;
+        *s = q&2     ? -ss : ss;
+        *c = (q+1)&2 ? -cc : cc;
+    }
+
+    bool more_energy(const Mode& a, const Mode& b) { return a.energy>b.energy; }
+
+}
+
+/*
+Picks the nb_modes most energetic waves of all the cascades, among the active
+waves the FFT computes so that the error bound holds against it, and computes
+the energy fraction they represent and the error bound.
+*/
+SparseOcean::SparseOcean(Cascade* const p_ocean, const int nb_modes) :
+    ocean(p_ocean),
+    energy_fraction(1),
+    error_bound(0) {
+    for(int i=0 ; i<ocean->get_nb_cascades() ; i++) {
+        const std::vector<Mode>& active = ocean->get_ocean(i)->get_active_modes();
+        modes.insert(modes.end(), active.begin(), active.end());
+    }
+    const std::size_t nb = std::min(modes.size(), static_cast<std::size_t>(std::max(0, nb_modes)));
+    std::partial_sort(modes.begin(), modes.begin()+nb, modes.end(), more_energy);
+    double total = 0;
+    double kept  = 0;
+    for(std::size_t i=0 ; i<modes.size() ; i++) {
+        total += modes[i].energy;
+        if(i<nb) {
+            kept += modes[i].energy;
+        }
+        else {
+            error_bound += 2*(sqrt(modes[i].h0R*modes[i].h0R + modes[i].h0I*modes[i].h0I) + sqrt(modes[i].h0mR*modes[i].h0mR + modes[i].h0mI*modes[i].h0mI));
+        }
+    }
+    if(total>0) energy_fraction = kept/total;
+    modes.resize(nb);
+    kx.resize(nb);
+    ky.resize(nb);
+    HR.resize(nb);
+    HI.resize(nb);
+    for(std::size_t i=0 ; i<nb ; i++) {
+        kx[i] = modes[i].kx;
+        ky[i] = modes[i].ky;
+    }
+    set_time(0);
+}
+
+/*
+Returns the number of points above which a full FFT of the cascade is
+cheaper than the direct evaluation with nb_modes waves. This is a rough cost
+model: a FFT costs about 2.N.log2(N) operations per cascade for N points,
+and the direct evaluation about nb_modes operations per point.
+*/
+const std::size_t SparseOcean::break_even(const int nb_modes, const int nx, const int ny, const int nb_cascades) {
+    const double n = static_cast<double>(nx)*ny;
+    return static_cast<std::size_t>(2*n*log2(n)*nb_cascades/std::max(1, nb_modes));
+}
+
+/*
+Computes 2.H(k, t) for every kept wave. This is done once per frame,
+before evaluating the points.
+*/
+void SparseOcean::set_time(const double t) {
+    for(std::size_t i=0 ; i<modes.size() ; i++) {
+        const Mode&  m = modes[i];
+        const double c = cos(m.omega*t);
+        const double s = sin(m.omega*t);
+        HR[i] = 2*(m.h0R*c - m.h0I*s + m.h0mR*c - m.h0mI*s);
+        HI[i] = 2*(m.h0I*c + m.h0R*s - m.h0mI*c - m.h0mR*s);
+    }
+}
+
+/*
+Computes the height at the n actual positions (xs[i], zs[i]) for the time
+given to the last call to set_time().
+*/
+void SparseOcean::evaluate(const float* const xs, const float* const zs, float* const out, const std::size_t n) const {
+    const int          nb  = get_nb_modes();
+    const float* const pkx = kx.data();
+    const float* const pky = ky.data();
+    const float* const pHR = HR.data();
+    const float* const pHI = HI.data();
+    for(std::size_t p=0 ; p<n ; p++) {
+        const float x = xs[p];
+        const float z = zs[p];
+        float       h = 0;
+        for(int i=0 ; i<nb ; i++) {
+            float s;
+            float c;
+            fast_sincos(pkx[i]*x + pky[i]*z, &s, &c);
+            h += pHR[i]*c - pHI[i]*s;
+        }
+        out[p] = h;
+    }
+}
+
+/*
+Computes the ocean with the FFT at time t, and returns the maximum difference
+with the direct evaluation at nb_points random points of the grid of the first
+cascade. These points are also on the grids of the other cascades when the
+cascade ratio is an integer, otherwise the error includes their interpolation.
+*/
+const double SparseOcean::measure_error(const double t, const int nb_points) {
+    std::mt19937                       generator(0);
+    std::uniform_int_distribution<int> gx(0, ocean->get_nx()-1);
+    std::uniform_int_distribution<int> gy(0, ocean->get_ny()-1);
+    std::vector<float>                 xs(nb_points);
+    std::vector<float>                 zs(nb_points);
+    std::vector<float>                 fft(nb_points);
+    std::vector<float>                 direct(nb_points);
+    for(int i=0 ; i<nb_points ; i++) {
+        xs[i] = gx(generator)*ocean->get_lx()/ocean->get_nx();
+        zs[i] = gy(generator)*ocean->get_ly()/ocean->get_ny();
+    }
+    ocean->main_computation(t);
+    ocean->sample_heights(xs.data(), zs.data(), fft.data(), nb_points);
+    set_time(t);
+    evaluate(xs.data(), zs.data(), direct.data(), nb_points);
+    double error = 0;
+    for(int i=0 ; i<nb_points ; i++) error = std::max(error, static_cast<double>(std::abs(fft[i]-direct[i])));
+    return error;
+}
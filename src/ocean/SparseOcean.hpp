@@ -0,0 +1,77 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class evaluates the height of the ocean directly at a few points, without any
+FFT. The K most energetic of the waves the FFT computes, above the mode cutoff of each
+cascade, are picked once, and the height at x is the sum over these waves of
+2.Re(H(k, t).e^(ik.x)). This costs K operations per point instead of a full 2D FFT
+per frame, which is much cheaper for a handful of points,
+like the buoys of a dedicated server. break_even() gives the number of points above which
+the FFT gets cheaper. The sines and cosines are computed with polynomials that the compiler
+can vectorize.
+The error compared to the FFT comes from the dropped waves. get_error_bound() gives the
+worst case, the sum of their amplitudes, and measure_error() gives the actual maximum error
+at some grid points. The displacement of choppy waves is not taken into account.
+*/
+
+#ifndef SPARSEOCEANHPP
+#define SPARSEOCEANHPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Cascade.hpp"
+#include "Mode.hpp"
+
+class SparseOcean {
+
+    public:
+
+        SparseOcean(Cascade* const, const int);
+        ~SparseOcean() {}
+
+        static const std::size_t break_even(const int, const int, const int, const int);
+
+        const int    get_nb_modes()        const { return static_cast<int>(kx.size()); }
+        const double get_energy_fraction() const { return energy_fraction; }
+        const double get_error_bound()     const { return error_bound; }
+
+        void         set_time(const double);
+        void         evaluate(const float* const, const float* const, float* const, const std::size_t) const;
+        const double measure_error(const double, const int);
+
+    private:
+
+        Cascade* const     ocean;             /* the ocean the waves come from */
+        std::vector<Mode>  modes;             /* the kept waves */
+        std::vector<float> kx;                /* wave vectors along x */
+        std::vector<float> ky;                /* wave vectors along z */
+        std::vector<float> HR;                /* 2.H(k, t), real part */
+        std::vector<float> HI;                /* 2.H(k, t), imaginary part */
+        double             energy_fraction;   /* energy of the kept waves over the total energy */
+        double             error_bound;       /* maximum error due to the dropped waves */
+
+};
+
+#endif
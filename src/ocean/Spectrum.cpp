@@ -0,0 +1,131 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Spectrum.hpp"
+
+const double Spectrum::G     = 9.81;
+const double Spectrum::GAMMA = 3.3;
+
+/*
+Initializes the variables, and the constants of the spectrum. The directional
+spreading cos(theta)^(2.wind_alignment) is normalized so that it integrates to
+one around the circle.
+*/
+Spectrum::Spectrum(const MODEL p_model, const double p_lx, const double p_ly, const int p_nx, const int p_ny, const double p_wind_speed, const int p_wind_alignment, const double p_min_wave_size, const double p_A, const double p_fetch, const double p_depth, const double p_k_min, const double p_k_max) :
+    model(p_model),
+    lx(p_lx),
+    ly(p_ly),
+    nx(p_nx),
+    ny(p_ny),
+    wind_speed(p_wind_speed),
+    wind_alignment(p_wind_alignment),
+    min_wave_size(p_min_wave_size),
+    A(p_A),
+    fetch(p_fetch),
+    depth(p_depth),
+    k_min(p_k_min),
+    k_max(p_k_max) {
+    L_sq      = pow((wind_speed*wind_speed)/G, 2);
+    spreading = tgamma(wind_alignment+1)/(2*sqrt(M_PI)*tgamma(wind_alignment+0.5));
+    if(model==PIERSON_MOSKOWITZ) {
+        alpha   = 0.0081;
+        omega_p = 0.855*G/wind_speed;
+    }
+    else {
+        alpha   = 0.076*pow(wind_speed*wind_speed/(fetch*G), 0.22);
+        omega_p = 22*cbrt(G*G/(wind_speed*fetch));
+    }
+}
+
+/*
+Computes the frequency spectrum S(omega) of the Pierson-Moskowitz, JONSWAP or
+TMA models, times the conversion to a wave number spectrum (d omega/dk)/k with
+omega = sqrt(g.k). The TMA spectrum uses the Kitaigorodskii depth attenuation.
+The model is a template parameter, so that the loops calling this function have
+no branch and can be vectorized.
+*/
+template<Spectrum::MODEL M>
+inline const double Spectrum::frequency_spectrum(const double k, const double alpha, const double omega_p, const double depth) {
+    const double omega = sqrt(G*k);
+    const double r     = omega_p/omega;
+    const double r4    = r*r*r*r;
+    const double pm    = alpha*G*G/(omega*omega*omega*omega*omega)*exp(-1.25*r4);
+    const double sigma = omega<=omega_p ? 0.07 : 0.09;
+    const double d     = (omega-omega_p)/(sigma*omega_p);
+    const double peak  = exp(log(GAMMA)*exp(-0.5*d*d));
+    const double wh    = omega*sqrt(depth/G);
+    const double wc    = std::min(wh, 2.0);
+    const double tma   = wh<=1 ? 0.5*wh*wh : 1-0.5*(2-wc)*(2-wc);
+    const double s     = M==PIERSON_MOSKOWITZ ? pm : M==JONSWAP ? pm*peak : pm*peak*tma;
+    return s*G/(2*omega*k);
+}
+
+/*
+Computes the spectrum for the column i of the grid, that is for the ny+1 waves
+of wave vector (2.pi.(i-nx/2)/lx, 2.pi.(j-ny/2)/ly).
+*/
+void Spectrum::evaluate(const int i, double* const out) const {
+    switch(model) {
+        case PHILIPPS:          evaluate_column<PHILIPPS>(i, out);          break;
+        case PIERSON_MOSKOWITZ: evaluate_column<PIERSON_MOSKOWITZ>(i, out); break;
+        case JONSWAP:           evaluate_column<JONSWAP>(i, out);           break;
+        case TMA:               evaluate_column<TMA>(i, out);               break;
+    }
+}
+
+/*
+Computes the spectrum of the given model for the column i. The Philipps spectrum
+is the one of J. Tessendorf's paper. The frequency spectra give the variance
+density E(k) = S(omega).(d omega/dk)/k.D(theta), and the stored value is half
+the variance of the wave, as for the Philipps spectrum. The waves out of the
+band are computed as if k was 1, and dropped at the end. The directional
+spreading and the damping of the small waves share one exponential.
+*/
+template<Spectrum::MODEL M>
+void Spectrum::evaluate_column(const int i, double* const out) const {
+    const int    n     = ny;
+    const int    a     = wind_alignment;
+    const double kx    = (2*M_PI*(i-nx/2))/lx;
+    const double dky   = 2*M_PI/ly;
+    const double l_sq  = min_wave_size*min_wave_size;
+    const double k0_sq = k_min*k_min;
+    const double k1_sq = k_max*k_max;
+    const double L2    = L_sq;
+    const double al    = alpha;
+    const double wp    = omega_p;
+    const double h     = depth;
+    const double scale = M==PHILIPPS ? A : spreading*(2*M_PI/lx)*dky/2;
+    for(int j=0 ; j<=n ; j++) {
+        const double ky     = dky*(j-n/2);
+        const double k_sq   = kx*kx + ky*ky;
+        const bool   in     = (k_sq>0) & (k_sq>=k0_sq) & (k_sq<k1_sq);
+        const double ks_sq  = in ? k_sq : 1;
+        const double cos_sq = std::max((kx*kx)/ks_sq, 1e-300);
+        const double damp   = a*log(cos_sq) - ks_sq*l_sq;
+        const double shape  = M==PHILIPPS ? exp(damp - 1/(ks_sq*L2))/(ks_sq*ks_sq) : exp(damp)*frequency_spectrum<M>(sqrt(ks_sq), al, wp, h);
+        out[j] = in ? scale*shape : 0;
+    }
+}
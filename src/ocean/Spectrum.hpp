@@ -0,0 +1,84 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class implements the spectra of the ocean waves. The Philipps spectrum is the one of
+J. Tessendorf's paper. The Pierson-Moskowitz spectrum describes a sea fully developed by a
+constant wind, the JONSWAP spectrum a sea still growing over a limited fetch, with a sharper
+peak, and the TMA spectrum is the JONSWAP spectrum damped in shallow water of the given depth.
+These three are frequency spectra, turned into wave number spectra with the deep water
+dispersion relation, and they give the actual variance of each wave, so the adjustment
+parameter A only applies to the Philipps spectrum.
+The spectrum contains the scene parameters, as they have an impact on the waves shape: wind
+speed, wind alignment (how the waves align with the wind direction, along x) and the minimum
+wave size. It can be limited to a band of wave numbers, so that several oceans of different
+sizes can share the spectrum without counting the same waves twice.
+A whole column of the grid is evaluated at once, in a loop without branches that the
+compiler can vectorize.
+*/
+
+#ifndef SPECTRUMHPP
+#define SPECTRUMHPP
+
+class Spectrum {
+    
+    public:
+
+        enum MODEL {PHILIPPS, PIERSON_MOSKOWITZ, JONSWAP, TMA};
+    
+        Spectrum(const MODEL, const double, const double, const int, const int, const double, const int, const double, const double, const double, const double, const double, const double);
+        ~Spectrum() {}
+    
+        void evaluate(const int, double* const) const;
+    
+    private:
+
+        static const double G;         /* gravity */
+        static const double GAMMA;     /* peak enhancement of the JONSWAP spectrum */
+
+        template<MODEL M> void         evaluate_column(const int, double* const) const;
+        template<MODEL M> static const double frequency_spectrum(const double, const double, const double, const double);
+  
+        const MODEL  model;            /* shape of the spectrum */
+        const double lx;               /* actual width of the scene */
+        const double ly;               /* actual height of the scene */
+        const int    nx;               /* nb of x points - must be a power of 2 */
+        const int    ny;               /* nb of y points - must be a power of 2 */
+    
+        const double wind_speed;       /* wind speed */
+        const int    wind_alignment;   /* the greater it is, the better waves are in the wind's direction */
+        const double min_wave_size;    /* waves are deleted if below this size */
+        const double A;                /* numeric constant to adjust the waves height of the Philipps spectrum */
+        const double fetch;            /* distance over which the wind blows, for the JONSWAP and TMA spectra */
+        const double depth;            /* depth of the sea, for the TMA spectrum */
+        const double k_min;            /* wave numbers below k_min are removed */
+        const double k_max;            /* wave numbers above or equal to k_max are removed */
+
+        double       L_sq;             /* square of the largest wave length of the Philipps spectrum */
+        double       alpha;            /* energy scale of the frequency spectra */
+        double       omega_p;          /* peak angular frequency of the frequency spectra */
+        double       spreading;        /* normalization of the directional spreading */
+    
+};
+
+#endif
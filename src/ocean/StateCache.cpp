@@ -0,0 +1,131 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "StateCache.hpp"
+
+/*
+Initializes the variables. The key must change whenever a parameter
+changes the state of the ocean.
+*/
+StateCache::StateCache(Cascade* const p_ocean, const std::string& p_file, const uint64_t p_key) :
+    ocean(p_ocean),
+    file(p_file),
+    key(p_key),
+    size(0) {
+    for(int i=0 ; i<ocean->get_nb_cascades() ; i++) size += ocean->get_ocean(i)->get_state_size();
+}
+
+/*
+FNV-1a hash of the given bytes. Several buffers can be hashed together
+by giving the hash of the previous ones as the initial value.
+*/
+const uint64_t StateCache::hash(const void* const data, const std::size_t n, const uint64_t initial) {
+    const unsigned char* const bytes = static_cast<const unsigned char*>(data);
+    uint64_t                   h     = initial;
+    for(std::size_t i=0 ; i<n ; i++) {
+        h ^= bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/*
+Returns the header of a file saved at time t.
+*/
+const StateCache::header StateCache::make_header(const double t) const {
+    header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "FFTSTATE", sizeof(h.magic));
+    h.version     = 2;
+    h.nb_cascades = ocean->get_nb_cascades();
+    h.nx          = ocean->get_nx();
+    h.ny          = ocean->get_ny();
+    h.key         = key;
+    h.size        = size;
+    h.time        = t;
+    return h;
+}
+
+/*
+Restores the oceans from the file, and gives the time at which they were saved.
+Returns false, without changing anything, if the file does not exist or does not
+match the parameters.
+*/
+const bool StateCache::load(double* const time) {
+    const std::size_t file_size = sizeof(header) + sizeof(double)*size;
+    const int         fd        = open(file.c_str(), O_RDONLY);
+    struct stat       st;
+    if(fd<0) return false;
+    if(fstat(fd, &st)!=0 || static_cast<std::size_t>(st.st_size)!=file_size) {
+        close(fd);
+        return false;
+    }
+    void* const mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping==MAP_FAILED) return false;
+    header       expected = make_header(0);
+    const header found    = *static_cast<const header*>(mapping);
+    expected.time         = found.time;
+    const bool   matches  = memcmp(&found, &expected, sizeof(header))==0;
+    if(matches) {
+        madvise(mapping, file_size, MADV_SEQUENTIAL);
+        const double* state = reinterpret_cast<const double*>(static_cast<const char*>(mapping) + sizeof(header));
+        for(int i=0 ; i<ocean->get_nb_cascades() ; i++) {
+            ocean->get_ocean(i)->load_state(state);
+            state += ocean->get_ocean(i)->get_state_size();
+        }
+        *time = found.time;
+    }
+    munmap(mapping, file_size);
+    return matches;
+}
+
+/*
+Saves the oceans at time t, which is the time of the next frame to compute
+when the simulation is resumed.
+*/
+void StateCache::save(const double t) const {
+    const std::string tmp = file + ".tmp";
+    const header      h   = make_header(t);
+    FILE* const       f   = fopen(tmp.c_str(), "wb");
+    bool              ok  = f && fwrite(&h, sizeof(h), 1, f)==1;
+    for(int i=0 ; ok && i<ocean->get_nb_cascades() ; i++) {
+        std::vector<double> state(ocean->get_ocean(i)->get_state_size());
+        ocean->get_ocean(i)->save_state(state.data());
+        ok = fwrite(state.data(), sizeof(double), state.size(), f)==state.size();
+    }
+    if(f && fclose(f)!=0) ok = false;
+    if(!ok || rename(tmp.c_str(), file.c_str())!=0) {
+        remove(tmp.c_str());
+        throw std::runtime_error("cannot save the state file " + file);
+    }
+}
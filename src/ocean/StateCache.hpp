@@ -0,0 +1,80 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class saves the state of a cascade to a binary file and restores it, so that a
+run can start without generating the spectrum again, and a simulation can be stopped
+and resumed where it was. The file holds a versioned header, the time of the simulation,
+and the state of every ocean (see Ocean::save_state). The header also holds a key, the
+hash of every parameter the state depends on, so that a file saved with other parameters
+or another seed is never loaded. A file is loaded by mapping it in memory, and saved to a
+temporary file renamed at the end, so that an interrupted save never leaves a broken file.
+*/
+
+#ifndef STATECACHEHPP
+#define STATECACHEHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Cascade.hpp"
+
+class StateCache {
+
+    public:
+
+        StateCache(Cascade* const, const std::string&, const uint64_t);
+        ~StateCache() {}
+
+        static const uint64_t hash(const void* const, const std::size_t, const uint64_t=FNV_OFFSET);
+
+        const bool load(double* const);
+        void       save(const double) const;
+
+    private:
+
+        static const uint64_t FNV_OFFSET = 14695981039346656037ULL;   /* initial value of the FNV-1a hash */
+        static const uint64_t FNV_PRIME  = 1099511628211ULL;          /* multiplier of the FNV-1a hash */
+
+        struct header {
+            char     magic[8];      /* "FFTSTATE" without the final zero */
+            uint32_t version;       /* version of the file format */
+            uint32_t nb_cascades;   /* nb of oceans */
+            uint32_t nx;            /* nb of x subdivisions */
+            uint32_t ny;            /* nb of y subdivisions */
+            uint64_t key;           /* hash of the parameters */
+            uint64_t size;          /* nb of doubles after the header */
+            double   time;          /* time of the simulation, in seconds */
+        };
+
+        const header make_header(const double) const;
+
+        Cascade* const    ocean;   /* ocean to save or restore */
+        const std::string file;    /* path of the state file */
+        const uint64_t    key;     /* hash of the parameters */
+        std::size_t       size;    /* nb of doubles of the states of all the oceans */
+
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Tiling.hpp"
+
+/*
+Initializes the variables. The transforms of the tiles are drawn from the last
+stream of the seed, which no cascade uses.
+*/
+Tiling::Tiling(Cascade* const p_ocean, const uint32_t seed) :
+    ocean(p_ocean),
+    lx(p_ocean->get_lx()),
+    ly(p_ocean->get_ly()),
+    nx(p_ocean->get_frame_nx()),
+    ny(p_ocean->get_frame_ny()),
+    hash(seed, 0xFFFFFFFF) {
+}
+
+/*
+Returns the transform of the tile (i, j), the tile (0, 0) being the ocean itself.
+*/
+const Tiling::Transform Tiling::transform(const int i, const int j) const {
+    Transform t = {0, 0, false, false};
+    uint32_t  r[4];
+    if(i==0 && j==0) return t;
+    hash(static_cast<uint32_t>(i), static_cast<uint32_t>(j), 0, 0, r);
+    t.ox     = r[0] & (nx-1);
+    t.oy     = r[1] & (ny-1);
+    t.flip_x = r[2] & 1;
+    t.flip_z = r[3] & 1;
+    return t;
+}
+
+/*
+Gives the weights of the point at X cells from the first edge of a tile, which has
+n cells along that axis. In the border, the point at the distance d from the edge
+has the weights cos(a) for the tile and sin(a) for the neighbour on the side of
+that edge, side being -1 or 1, a going from pi/4 at the edge to 0 at the inner
+limit of the border. Out of the border, side is 0.
+*/
+inline void Tiling::blend(const double X, const int n, double* const own, double* const other, int* const side) {
+    const int    width = std::max(1, n/BORDER);
+    const double d     = std::min(X, n-X);
+    if(d>=width) {
+        *own   = 1;
+        *other = 0;
+        *side  = 0;
+        return;
+    }
+    const double angle = M_PI/4*(1 - d/width);
+    *own   = cos(angle);
+    *other = sin(angle);
+    *side  = X<n-X ? -1 : 1;
+}
+
+/*
+Computes the weights of the border blending for the m+1 vertices X0, X0+step...
+of a row or a column of a tile, which has n cells of the frames.
+*/
+void Tiling::border(const int X0, const int m, const int step, const int n, std::vector<float>* const own, std::vector<float>* const other, std::vector<int>* const side) const {
+    own->resize(m+1);
+    other->resize(m+1);
+    side->resize(m+1);
+    for(int a=0 ; a<=m ; a++) {
+        double w[2];
+        blend(X0 + a*step, n, &w[0], &w[1], &(*side)[a]);
+        (*own)[a]   = w[0];
+        (*other)[a] = w[1];
+    }
+}
+
+/*
+Gives the actual positions (sx, sz) of the ocean that the actual position (x, z)
+of the plane blends, and their weights w: the position through the transform of
+its tile, and through the transforms of the neighbours in the border, up to four
+at a corner. The positions are not wrapped into the ocean. Returns their nb.
+*/
+const int Tiling::sources(const double x, const double z, double* const sx, double* const sz, float* const w) const {
+    const int    i = static_cast<int>(floor(x/lx));
+    const int    j = static_cast<int>(floor(z/ly));
+    const double X = (x - i*lx)*nx/lx;
+    const double Y = (z - j*ly)*ny/ly;
+    double       own[2];
+    double       other[2];
+    int          side[2];
+    int          k = 0;
+    blend(X, nx, &own[0], &other[0], &side[0]);
+    blend(Y, ny, &own[1], &other[1], &side[1]);
+    for(int b=0 ; b<=(side[1]!=0 ? 1 : 0) ; b++) {
+        for(int a=0 ; a<=(side[0]!=0 ? 1 : 0) ; a++) {
+            const Transform t = transform(i + a*side[0], j + b*side[1]);
+            const double    u = X - a*side[0]*nx;
+            const double    v = Y - b*side[1]*ny;
+            sx[k] = ((t.flip_x ? -u : u) + t.ox)*lx/nx;
+            sz[k] = ((t.flip_z ? -v : v) + t.oy)*ly/ny;
+            w[k]  = (a ? other[0] : own[0])*(b ? other[1] : own[1]);
+            k++;
+        }
+    }
+    return k;
+}
+
+/*
+Samples the heights of the plane at the n actual positions (xs[i], zs[i]) into
+out, as Cascade::sample_heights() does for the ocean: the positions of the ocean
+they blend are sampled together, by blocks of Ocean::SAMPLE_BLOCK positions of the
+plane, and their heights are summed with their weights.
+This must not be called while main_computation() is running.
+*/
+void Tiling::sample_heights(const float* const xs, const float* const zs, float* const out, const std::size_t n) const {
+    const int B = Ocean::SAMPLE_BLOCK;
+    double    sx[4];
+    double    sz[4];
+    float     px[4*B];
+    float     pz[4*B];
+    float     w[4*B];
+    float     h[4*B];
+    int       nb[B];
+    for(std::size_t i=0 ; i<n ; i+=B) {
+        const int m = static_cast<int>(std::min<std::size_t>(B, n-i));
+        int       k = 0;
+        for(int j=0 ; j<m ; j++) {
+            nb[j] = sources(xs[i+j], zs[i+j], sx, sz, &w[k]);
+            for(int c=0 ; c<nb[j] ; c++) {
+                px[k+c] = static_cast<float>(sx[c]);
+                pz[k+c] = static_cast<float>(sz[c]);
+            }
+            k += nb[j];
+        }
+        ocean->sample_heights(px, pz, h, k);
+        k = 0;
+        for(int j=0 ; j<m ; j++) {
+            float sum = 0;
+            for(int c=0 ; c<nb[j] ; c++) sum += w[k+c]*h[k+c];
+            out[i+j] = sum;
+            k += nb[j];
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class extends a periodic ocean to an infinite plane of tiles of its size, so
+that the repetition does not show. Every tile is the ocean through its own
+transform: an offset and mirrors along x and z, hashed from the position of the
+tile. The mirrors keep the statistics of the waves, since the spectrum is symmetric
+in kx and in ky, but a quarter turn would not, the waves following the wind along x.
+Over 1/BORDER of its width, a tile is blended with its neighbours sampled at the
+same position, with weights whose squares sum to 1 so that the height of the waves
+is kept, and which are the same on both sides of an edge, so that the tiles match.
+The tile (0, 0) is the ocean itself.
+The offsets are whole numbers of vertices of the frames, so that the rendering
+samples the frames without interpolation. Any actual position is given by the
+positions of the ocean it blends, and the heights are sampled there from the
+cascade, so that the probes, the rays and the bodies see the surface that is drawn.
+*/
+
+#ifndef TILINGHPP
+#define TILINGHPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Cascade.hpp"
+#include "Philox.hpp"
+
+class Tiling {
+
+    public:
+
+        struct Transform {
+            int  ox;       /* vertex of the frame at the first corner of the tile */
+            int  oy;
+            bool flip_x;   /* true if the tile is the frame mirrored along x */
+            bool flip_z;   /* true if the tile is the frame mirrored along z */
+        };
+
+        static const int BORDER = 8;   /* a tile is blended with each neighbour over 1/BORDER of its width */
+
+        Tiling(Cascade* const, const uint32_t);
+        ~Tiling() {}
+
+        const double get_lx()      const { return lx; }
+        const double get_ly()      const { return ly; }
+        const int    get_nx()      const { return nx; }
+        const int    get_ny()      const { return ny; }
+        const int    get_width_x() const { return std::max(1, nx/BORDER); }
+        const int    get_width_y() const { return std::max(1, ny/BORDER); }
+
+        const Transform transform(const int, const int) const;
+        void      border(const int, const int, const int, const int, std::vector<float>* const, std::vector<float>* const, std::vector<int>* const) const;
+        const int sources(const double, const double, double* const, double* const, float* const) const;
+        void      sample_heights(const float* const, const float* const, float* const, const std::size_t) const;
+
+    private:
+
+        static inline void blend(const double, const int, double* const, double* const, int* const);
+
+        Cascade* const ocean;   /* ocean repeated on the tiles */
+        const double   lx;      /* actual width of a tile */
+        const double   ly;      /* actual height of a tile */
+        const int      nx;      /* nb of x subdivisions of the frames */
+        const int      ny;      /* nb of y subdivisions of the frames */
+        const Philox   hash;    /* transforms of the tiles */
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadPool.hpp"
+
+/*
+Creates nb_threads-1 workers, the calling thread being
+used as the last one when running tasks.
+*/
+ThreadPool::ThreadPool(const int nb_threads) :
+    task(nullptr),
+    nb_tasks(0),
+    next(0),
+    running(0),
+    generation(0),
+    busy(false),
+    stop(false) {
+    for(int i=1 ; i<nb_threads ; i++) workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+/*
+Wakes the workers up so that they exit, and waits for them.
+*/
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake_up.notify_all();
+    for(std::size_t i=0 ; i<workers.size() ; i++) workers[i].join();
+}
+
+/*
+Runs p_task(i) for i in [0 ; p_nb_tasks[ and waits for all the tasks to
+be done. The tasks are picked one by one by the threads, so they do not
+need to have the same cost. With no worker, or when the workers are busy
+with another series, the tasks simply run in order.
+*/
+void ThreadPool::run(const std::function<void(const int)>& p_task, const int p_nb_tasks) {
+    bool serial = workers.empty() || p_nb_tasks<=1;
+    if(!serial) {
+        std::lock_guard<std::mutex> lock(mutex);
+        serial = busy;
+        busy   = true;
+    }
+    if(serial) {
+        for(int i=0 ; i<p_nb_tasks ; i++) p_task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task     = &p_task;
+        nb_tasks = p_nb_tasks;
+        next     = 0;
+        running  = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake_up.notify_all();
+    execute();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return running==0; });
+    task = nullptr;
+    busy = false;
+}
+
+/*
+Loop of the workers: waits for a new series of tasks and takes part in it.
+*/
+void ThreadPool::work() {
+    unsigned long seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake_up.wait(lock, [this, seen] { return stop || generation!=seen; });
+            if(stop) return;
+            seen = generation;
+        }
+        execute();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        done.notify_one();
+    }
+}
+
+/*
+Runs the tasks of the current series until there is none left.
+*/
+void ThreadPool::execute() {
+    for(int i=next++ ; i<nb_tasks ; i=next++) (*task)(i);
+}
@@ -0,0 +1,73 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class implements a pool of threads to run a series of independent tasks
+concurrently. run() gives the tasks 0 to n-1 to the workers and to the calling
+thread, and returns once all of them are done. The workers wait on a condition
+variable between two series, so that creating threads is only done once.
+A pool can be shared: when it is already running a series, for another thread or
+from one of its own tasks, run() simply runs the new tasks on the calling thread.
+*/
+
+#ifndef THREADPOOLHPP
+#define THREADPOOLHPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+
+    public:
+
+        ThreadPool(const int);
+        ~ThreadPool();
+
+        const int get_nb_threads() const { return static_cast<int>(workers.size())+1; }
+
+        void run(const std::function<void(const int)>&, const int);
+
+    private:
+
+        void work();
+        void execute();
+
+        std::vector<std::thread>               workers;      /* threads of the pool, the caller is the last one */
+        std::mutex                             mutex;        /* protects the variables below */
+        std::condition_variable                wake_up;      /* signals a new series of tasks */
+        std::condition_variable                done;         /* signals the end of a series */
+        const std::function<void(const int)>*  task;         /* task of the current series */
+        int                                    nb_tasks;     /* nb of tasks in the current series */
+        std::atomic<int>                       next;         /* next task to run */
+        int                                    running;      /* nb of workers still busy on the series */
+        unsigned long                          generation;   /* incremented for every series */
+        bool                                   busy;         /* true while a series is running */
+        bool                                   stop;         /* tells the workers to exit */
+
+};
+
+#endif
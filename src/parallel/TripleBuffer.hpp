@@ -0,0 +1,73 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class implements a lock-free triple buffer between one producer thread and
+one consumer thread. The producer writes into the back buffer and publishes it,
+which swaps it with the middle buffer. The consumer takes the middle buffer when
+a new one has been published, by swapping it with the front buffer. Neither side
+ever waits for the other one: the producer always has a buffer to write into, and
+the consumer always reads the latest complete buffer.
+The index of the middle buffer and a "new data" flag are packed in one atomic.
+*/
+
+#ifndef TRIPLEBUFFERHPP
+#define TRIPLEBUFFERHPP
+
+#include <atomic>
+
+template<typename T>
+class TripleBuffer {
+
+    public:
+
+        TripleBuffer() : middle(1), back(0), front(2) {}
+        ~TripleBuffer() {}
+
+        T*       get_back()        { return &buffers[back]; }
+        const T* get_front()       { return &buffers[front]; }
+        bool     has_new()   const { return (middle.load(std::memory_order_acquire) & FRESH)!=0; }
+
+        /* producer: makes the back buffer the latest one and gets another back buffer */
+        void publish() {
+            back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        /* consumer: gets the latest buffer if there is a new one, and returns the front buffer */
+        const T* acquire() {
+            if(has_new()) front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+            return &buffers[front];
+        }
+
+    private:
+
+        enum { INDEX = 3, FRESH = 4 };
+
+        T                buffers[3];   /* the three buffers */
+        std::atomic<int> middle;       /* index of the middle buffer, and FRESH if it was not read yet */
+        int              back;         /* index of the buffer being written, owned by the producer */
+        int              front;        /* index of the buffer being read, owned by the consumer */
+
+};
+
+#endif
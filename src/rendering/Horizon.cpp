@@ -0,0 +1,415 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Horizon.hpp"
+
+/*
+Initializes the variables. The tiles are drawn up to p_radius tiles away from the
+tile of the camera, and the noise takes over between the distances p_blend_start
+and p_blend_end. The noise follows the most energetic wave of the largest cascade,
+which must have been generated. The tiles are those of the tiling of the ocean
+with the seed, and are computed on p_pool.
+*/
+Horizon::Horizon(Cascade* const ocean, ThreadPool* const p_pool, const int p_radius, const double p_blend_start, const double p_blend_end, const double p_motion_factor, const uint32_t seed) :
+    lx(ocean->get_lx()),
+    ly(ocean->get_ly()),
+    nx(ocean->get_frame_nx()),
+    ny(ocean->get_frame_ny()),
+    step(std::min(STEP, std::min(ocean->get_frame_nx(), ocean->get_frame_ny())/2)),
+    max_step(std::min(ocean->get_frame_nx(), ocean->get_frame_ny())/2),
+    tiling(ocean, seed),
+    radius(p_radius),
+    blend_start(p_blend_start),
+    blend_end(p_blend_end),
+    motion_factor(p_motion_factor),
+    noise(nullptr),
+    pool(p_pool),
+    tiles((2*p_radius+1)*(2*p_radius+1)),
+    latest(-1),
+    camera_i(0),
+    camera_j(0),
+    latest_rms(0) {
+    std::vector<Mode> modes;
+    double            kx     = 2*M_PI/lx;
+    double            ky     = 0;
+    double            energy = 0;
+    ocean->get_ocean(0)->get_modes(&modes);
+    for(std::size_t i=0 ; i<modes.size() ; i++) {
+        if(modes[i].energy<=energy) continue;
+        energy = modes[i].energy;
+        kx     = modes[i].kx;
+        ky     = modes[i].ky;
+    }
+    noise = new Noise(2*M_PI/sqrt(kx*kx + ky*ky), kx, ky, seed);
+}
+
+/*
+Free memory.
+*/
+Horizon::~Horizon() {
+    delete noise;
+}
+
+/*
+Returns the distance from the camera to the farthest tile, for the perspective.
+*/
+const double Horizon::get_range() const {
+    return (radius+1)*sqrt(lx*lx + ly*ly);
+}
+
+/*
+Returns the weight of the noise at the actual position (x, z), the camera being at
+(cx, cz). It goes smoothly from 0 at blend_start to 1 at blend_end.
+*/
+const double Horizon::weight(const double cx, const double cz, const double x, const double z) const {
+    const double d = sqrt((x-cx)*(x-cx) + (z-cz)*(z-cz));
+    const double s = std::min(1.0, std::max(0.0, (d-blend_start)/(blend_end-blend_start)));
+    return s*s*(3-2*s);
+}
+
+/*
+Returns the step of the tile whose first corner is at the actual position (x, z),
+the camera being at (cx, cz). It is step for a tile with noise and 1 otherwise, and
+doubles each time the distance from the camera to the closest point of the tile
+doubles, from twice the size of a tile, or twice the start of the noise for a tile
+with noise.
+*/
+const int Horizon::tile_step(const double cx, const double cz, const double x, const double z, const bool with_noise) const {
+    const double dx = std::max(0.0, std::max(x-cx, cx-x-lx));
+    const double dz = std::max(0.0, std::max(z-cz, cz-z-ly));
+    const double d  = sqrt(dx*dx + dz*dz);
+    int          s  = with_noise ? step : 1;
+    for(double limit=2*std::max(with_noise ? blend_start : 0, std::max(lx, ly)) ; d>=limit && s<max_step ; limit*=2) s *= 2;
+    return std::min(s, max_step);
+}
+
+/*
+Gives the parts of a tile that are computed, with step vertices of the ocean per
+vertex of the tile: the whole tile, or only the 4 strips of its border if the tile
+is shared, which is to say drawn from the frame inside its border. Each part is
+given by its first vertex and its nb of cells along x and y, the vertices being in
+vertices of the ocean and the cells in cells of the tile. Returns the nb of parts.
+*/
+const int Horizon::parts(const bool shared, const int step, int (* const rects)[4]) const {
+    const int wx = tiling.get_width_x();
+    const int wy = tiling.get_width_y();
+    if(!shared) {
+        const int r[4] = {0, 0, nx/step, ny/step};
+        std::copy(r, r+4, rects[0]);
+        return 1;
+    }
+    const int r[4][4] = {{0, 0, nx, wy}, {0, ny-wy, nx, wy}, {0, wy, wx, ny-2*wy}, {nx-wx, wy, wx, ny-2*wy}};
+    for(int i=0 ; i<4 ; i++) std::copy(r[i], r[i]+4, rects[i]);
+    return 4;
+}
+
+/*
+Gives the patches of the frame that draw a shared tile inside its border, with the
+transform t of the tile. Along each axis, the vertices of the tile go through the
+frame from the offset, and wrap at its end: each run up to a wrap gives the first
+vertex of the frame, the nb of cells and the position of the origin of the frame,
+which is mirrored if the tile is. The last vertex of the frame is the first one
+moved by a period, so a run may end on it. The patches are the products of the runs
+along x and along y.
+*/
+void Horizon::patches(const Transform& t, Tile* const tile) const {
+    const int n[2]     = {nx, ny};
+    const int o[2]     = {t.ox, t.oy};
+    const int width[2] = {tiling.get_width_x(), tiling.get_width_y()};
+    const bool flip[2] = {t.flip_x, t.flip_z};
+    const double c[2]  = {tile->x, tile->z};
+    const double d[2]  = {lx/nx, ly/ny};
+    int          first[2][2];
+    int          count[2][2];
+    double       origin[2][2];
+    int          nb[2]  = {0, 0};
+    for(int a=0 ; a<2 ; a++) {
+        for(int X=width[a] ; X<n[a]-width[a] ; X+=count[a][nb[a]++]) {
+            if(flip[a]) {
+                const int v  = ((o[a] - X) & (n[a]-1)) == 0 ? n[a] : (o[a] - X) & (n[a]-1);
+                count[a][nb[a]]  = std::min(n[a]-width[a]-X, v);
+                first[a][nb[a]]  = v - count[a][nb[a]];
+                origin[a][nb[a]] = c[a] + (X+v)*d[a];
+            }
+            else {
+                const int v  = (X + o[a]) & (n[a]-1);
+                count[a][nb[a]]  = std::min(n[a]-width[a]-X, n[a]-v);
+                first[a][nb[a]]  = v;
+                origin[a][nb[a]] = c[a] + (X-v)*d[a];
+            }
+        }
+    }
+    tile->patches.clear();
+    for(int b=0 ; b<nb[1] ; b++) {
+        for(int a=0 ; a<nb[0] ; a++) {
+            const Patch p = {first[0][a], first[1][b], count[0][a], count[1][b], origin[0][a], origin[1][b], flip[0], flip[1]};
+            tile->patches.push_back(p);
+        }
+    }
+}
+
+/*
+Returns the RMS height of a frame.
+*/
+const double Horizon::rms(const Heightfield& frame) const {
+    const int nb  = (nx+1)*(ny+1);
+    double    sum = 0;
+    double    sq  = 0;
+    for(int i=0 ; i<nb ; i++) {
+        const double h = frame.vertices[Heightfield::STRIDE*i+1];
+        sum += h;
+        sq  += h*h;
+    }
+    return sqrt(std::max(0.0, sq/nb - (sum/nb)*(sum/nb)));
+}
+
+/*
+Adds to d, with the weight w, the displacement, the height and the rate of the
+height of the vertex (X, Y) of a tile with the transform t, in vertices of the
+ocean from the first corner of the tile. X and Y may be out of the tile, for the
+vertices of a neighbour. The rate is only added if the frame has the rates.
+*/
+void Horizon::sample(const Heightfield& frame, const Transform& t, const int X, const int Y, const float w, float* const d) const {
+    const int          sx = ((t.flip_x ? -X : X) + t.ox) & (nx-1);
+    const int          sy = ((t.flip_z ? -Y : Y) + t.oy) & (ny-1);
+    const float* const v  = frame.row(sy) + Heightfield::STRIDE*sx;
+    const float        dx = v[0] - static_cast<float>(lx/nx)*sx;
+    const float        dz = v[2] - static_cast<float>(ly/ny)*sy;
+    d[0] += w*(t.flip_x ? -dx : dx);
+    d[1] += w*v[1];
+    d[2] += w*(t.flip_z ? -dz : dz);
+    if(!frame.rates.empty()) d[3] += w*frame.rates[(nx+1)*sy + sx];
+}
+
+/*
+Updates the tiles around the camera, at the actual position (cx, cz), and
+interpolates them at the time t between the two latest frames of the ocean. The
+tiles are only computed again when the latest frame or the tile of the camera
+changes: if the previous frame is the one they were computed with, their vertices
+for it are kept, and only the ones for the latest frame are computed. Each tile is
+one task of the pool. The borders of the tiles are then stitched to their coarser
+neighbours.
+*/
+void Horizon::update(const Heightfield& previous, const Heightfield& current, const double t, const double cx, const double cz) {
+    const int side = 2*radius+1;
+    const int ci   = static_cast<int>(floor(cx/lx));
+    const int cj   = static_cast<int>(floor(cz/ly));
+    if(current.nx!=nx || current.ny!=ny) return;
+    if(current.time!=latest || ci!=camera_i || cj!=camera_j) {
+        const bool both    = previous.nx==nx && previous.ny==ny;
+        const bool follows = both && previous.time==latest && ci==camera_i && cj==camera_j;
+        const double heights[2] = {both && !follows ? rms(previous) : latest_rms, rms(current)};
+        pool->run([&](const int k) {
+            Tile* const  tile   = &tiles[k];
+            const int    i      = ci - radius + k%side;
+            const int    j      = cj - radius + k/side;
+            const double x      = i*lx;
+            const double z      = j*ly;
+            const double w[4]   = {weight(cx, cz, x, z), weight(cx, cz, x+lx, z), weight(cx, cz, x, z+ly), weight(cx, cz, x+lx, z+ly)};
+            const bool   noisy  = w[0]>0 || w[1]>0 || w[2]>0 || w[3]>0;
+            const int    s      = tile_step(cx, cz, x, z, noisy);
+            int          rects[4][4];
+            const int    nb     = parts(!noisy && s==1, s, rects);
+            const bool   kept   = follows && s==tile->step && static_cast<int>(tile->to.size())==nb;
+            tile->x    = x;
+            tile->z    = z;
+            tile->step = s;
+            if(kept) std::swap(tile->from, tile->to);
+            tile->from.resize(nb);
+            tile->to.resize(nb);
+            tile->surfaces.resize(nb);
+            for(int p=0 ; p<nb ; p++) {
+                if(!kept && both) fill_part(previous, i, j, s, rects[p], w, heights[0], &tile->from[p]);
+                else if(!kept)    tile->from[p].vertices.clear();
+                fill_part(current, i, j, s, rects[p], w, heights[1], &tile->to[p]);
+            }
+            if(nb>1) patches(tiling.transform(i, j), tile);
+            else     tile->patches.clear();
+        }, static_cast<int>(tiles.size()));
+        latest      = current.time;
+        camera_i    = ci;
+        camera_j    = cj;
+        latest_rms  = heights[1];
+    }
+    pool->run([&](const int k) {
+        Tile* const tile = &tiles[k];
+        for(std::size_t p=0 ; p<tile->surfaces.size() ; p++) tile->surfaces[p].interpolate(tile->from[p], tile->to[p], t);
+    }, static_cast<int>(tiles.size()));
+    for(int j=0 ; j<side ; j++) {
+        for(int i=0 ; i<side ; i++) {
+            Tile* const tile = &tiles[side*j + i];
+            if(i>0)      stitch(tile, tiles[side*j + i-1], true, false);
+            if(i<side-1) stitch(tile, tiles[side*j + i+1], true, true);
+            if(j>0)      stitch(tile, tiles[side*(j-1) + i], false, false);
+            if(j<side-1) stitch(tile, tiles[side*(j+1) + i], false, true);
+        }
+    }
+}
+
+/*
+Computes the vertices s of a part of the tile (i, j), with step vertices of the
+ocean per vertex of the tile, from a frame of the ocean and the noise, with the
+weights w of the noise at the four corners of the tile: (x, z), (x+lx, z), (x, z+ly)
+and (x+lx, z+ly). The part is given by its first vertex and its nb of cells, as by
+parts(). The frame is sampled through the transform of the tile, and blended in the
+borders with the transforms of the neighbours, up to four at a corner. Where the
+noise is used, the vertex moves from there towards the noise, scaled to the RMS
+height of the frame, on a flat grid. Each row is filled in one pass, the noise being
+computed at once for the vertices of the row that need it, and the normals of the
+previous row follow, as for an ocean frame.
+The rates of the heights are blended like the heights if the frame has them, the
+noise having none, so that the tiles are interpolated in time like the frames.
+A part is filled with one more vertex on each side inside the tile, which is then
+cut off, so that the normals of its edges are the ones of the whole tile.
+*/
+void Horizon::fill_part(const Heightfield& frame, const int i, const int j, const int step, const int* const rect, const double* const w, const double height, Heightfield* const s) const {
+    const int          S     = Heightfield::STRIDE;
+    const int          ax    = rect[0]>0 ? 1 : 0;
+    const int          ay    = rect[1]>0 ? 1 : 0;
+    const int          bx    = rect[0] + step*rect[2]<nx ? 1 : 0;
+    const int          by    = rect[1] + step*rect[3]<ny ? 1 : 0;
+    const int          X0    = rect[0] - step*ax;
+    const int          Y0    = rect[1] - step*ay;
+    const int          mx    = rect[2] + ax + bx;
+    const int          my    = rect[3] + ay + by;
+    const double       t     = motion_factor*frame.time;
+    const double       x0    = i*lx;
+    const double       z0    = j*ly;
+    const bool         rated = !frame.rates.empty();
+    std::vector<float> xs(mx+1);
+    std::vector<float> zs(mx+1);
+    std::vector<float> heights(mx+1);
+    std::vector<float> weights(mx+1);
+    std::vector<int>   noisy(mx+1);
+    std::vector<float> own_x, own_z, other_x, other_z;
+    std::vector<int>   side_x, side_z;
+    Heightfield        grown;
+    Heightfield* const g     = ax+ay+bx+by>0 ? &grown : s;
+    Transform          around[3][3];
+    for(int b=-1 ; b<=1 ; b++) {
+        for(int a=-1 ; a<=1 ; a++) around[b+1][a+1] = tiling.transform(i+a, j+b);
+    }
+    tiling.border(X0, mx, step, nx, &own_x, &other_x, &side_x);
+    tiling.border(Y0, my, step, ny, &own_z, &other_z, &side_z);
+    g->nx   = mx;
+    g->ny   = my;
+    g->time = frame.time;
+    g->vertices.resize(S*(mx+1)*(my+1));
+    g->rates.resize(rated ? (mx+1)*(my+1) : 0);
+    for(int y=0 ; y<=my ; y++) {
+        const int          Y   = Y0 + step*y;
+        const int          b   = side_z[y];
+        float* const       dst = g->row(y);
+        float* const       r   = rated ? &g->rates[(mx+1)*y] : nullptr;
+        const double       fy  = static_cast<double>(Y)/ny;
+        const double       wl  = w[0] + fy*(w[2]-w[0]);
+        const double       wr  = w[1] + fy*(w[3]-w[1]);
+        int                m   = 0;
+        for(int x=0 ; x<=mx ; x++) {
+            const int    X    = X0 + step*x;
+            const int    a    = side_x[x];
+            float* const o    = dst + S*x;
+            const float  wv   = wl + (wr-wl)*X/nx;
+            float        d[4] = {0, 0, 0, 0};
+            sample(frame, around[1][1], X, Y, own_x[x]*own_z[y], d);
+            if(a!=0)         sample(frame, around[1][1+a], X - a*nx, Y, other_x[x]*own_z[y], d);
+            if(b!=0)         sample(frame, around[1+b][1], X, Y - b*ny, own_x[x]*other_z[y], d);
+            if(a!=0 && b!=0) sample(frame, around[1+b][1+a], X - a*nx, Y - b*ny, other_x[x]*other_z[y], d);
+            o[0] = x0 + (lx/nx)*X + d[0];
+            o[1] = d[1];
+            o[2] = z0 + (ly/ny)*Y + d[2];
+            if(rated) r[x] = d[3];
+            if(wv<=0) continue;
+            noisy[m]   = x;
+            weights[m] = wv;
+            xs[m]      = x0 + (lx/nx)*X;
+            zs[m]      = z0 + (ly/ny)*Y;
+            m++;
+        }
+        noise->heights(xs.data(), zs.data(), heights.data(), m, t);
+        for(int k=0 ; k<m ; k++) {
+            float* const o = dst + S*noisy[k];
+            o[0] += weights[k]*(xs[k] - o[0]);
+            o[1] += weights[k]*(height*heights[k] - o[1]);
+            o[2] += weights[k]*(zs[k] - o[2]);
+            if(rated) r[noisy[k]] *= 1-weights[k];
+        }
+        if(y>=1) g->compute_normals(y-1, lx, ly, false);
+    }
+    g->compute_normals(my, lx, ly, false);
+    if(g==s) return;
+    s->nx   = rect[2];
+    s->ny   = rect[3];
+    s->time = frame.time;
+    s->vertices.resize(S*(s->nx+1)*(s->ny+1));
+    s->rates.resize(rated ? (s->nx+1)*(s->ny+1) : 0);
+    for(int y=0 ; y<=s->ny ; y++) {
+        std::copy(g->row(y+ay) + S*ax, g->row(y+ay) + S*(ax+s->nx+1), s->row(y));
+        if(rated) std::copy(&g->rates[(mx+1)*(y+ay) + ax], &g->rates[(mx+1)*(y+ay) + ax+s->nx+1], &s->rates[(s->nx+1)*y]);
+    }
+}
+
+/*
+Returns the vertex (x, y) of a tile at the displayed time, in vertices of the tile,
+from the part that holds it. The vertex must be on the edge of the tile if only the
+strips of the border are computed.
+*/
+float* const Horizon::vertex(Tile* const tile, const int x, const int y) const {
+    const int                 S  = Heightfield::STRIDE;
+    const int                 wx = tiling.get_width_x();
+    const int                 wy = tiling.get_width_y();
+    std::vector<Heightfield>& s  = tile->surfaces;
+    if(s.size()==1) return s[0].row(y) + S*x;
+    if(y<=wy)       return s[0].row(y) + S*x;
+    if(y>=ny-wy)    return s[1].row(y-(ny-wy)) + S*x;
+    if(x<=wx)       return s[2].row(y-wy) + S*x;
+    return s[3].row(y-wy) + S*(x-(nx-wx));
+}
+
+/*
+Moves the vertices of a border of the tile onto the border of its neighbour when
+the neighbour is coarser, so that no crack opens between them: the vertices that
+the neighbour does not have are put on the straight line between the ones it has.
+The border is the last or the first column if vertical, the last or the first row
+otherwise. Only the positions are changed.
+*/
+void Horizon::stitch(Tile* const tile, const Tile& neighbour, const bool vertical, const bool last) {
+    if(neighbour.step<=tile->step) return;
+    const int ratio = neighbour.step/tile->step;
+    const int mx    = nx/tile->step;
+    const int my    = ny/tile->step;
+    const int n     = vertical ? my : mx;
+    const int line  = last ? (vertical ? mx : my) : 0;
+    for(int a=0 ; a<n ; a+=ratio) {
+        float* const v0 = vertical ? vertex(tile, line, a)       : vertex(tile, a, line);
+        float* const v1 = vertical ? vertex(tile, line, a+ratio) : vertex(tile, a+ratio, line);
+        for(int b=1 ; b<ratio ; b++) {
+            float* const v = vertical ? vertex(tile, line, a+b) : vertex(tile, a+b, line);
+            const float  f = static_cast<float>(b)/ratio;
+            for(int c=0 ; c<3 ; c++) v[c] = v0[c] + f*(v1[c]-v0[c]);
+        }
+    }
+}
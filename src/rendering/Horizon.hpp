@@ -0,0 +1,133 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class draws the ocean as an infinite plane around the camera. The plane is cut
+into the tiles of a Tiling, around the tile of the camera: every tile samples the
+frame of the ocean through its own transform, and is blended with its neighbours in
+its border.
+The far tiles blend the frame with waves of gradient noise, which hide the
+repetition. The weight of the noise grows with the distance to the camera, from 0
+at the near distance to 1 at the far distance. It is computed at the corners of
+each tile and interpolated over the tile, so that the neighbour tiles match. The
+tiles with some noise have a grid at least STEP times coarser than the ocean, the
+other ones have the grid of the ocean, and the grids are twice coarser again each
+time their distance to the camera doubles. The noise is only computed at the
+vertices where its weight is not zero. Where a tile meets a coarser one, its border
+follows the border of the coarser tile.
+Inside its border, a tile without noise on the grid of the ocean is the frame itself,
+shifted and mirrored: it is not computed, but given as at most 4 patches of the
+frame, one for each wrap of the offset, each with the translation and the mirrors
+that put it in place, and the rendering draws the frame there. Only the 4 strips of
+its border are computed.
+The tiles are computed on the pool of threads of the oceans, one task per tile, and
+only when the simulation gives a new frame or the camera moves to another tile: the
+tiles of the two latest frames are kept, and every draw only interpolates between
+them, like the frames of the ocean.
+The noise has the RMS height of the frame, and the wavelength and the direction of
+the most energetic wave of the largest cascade when the horizon is created.
+*/
+
+#ifndef HORIZONHPP
+#define HORIZONHPP
+
+#include <cstdint>
+#include <vector>
+
+#include "ocean/Cascade.hpp"
+#include "ocean/Heightfield.hpp"
+#include "ocean/Noise.hpp"
+#include "ocean/Tiling.hpp"
+#include "parallel/ThreadPool.hpp"
+
+class Horizon {
+
+    public:
+
+        struct Patch {
+            int    x;           /* first vertex of the frame */
+            int    y;
+            int    nx;          /* nb of cells of the frame along x */
+            int    ny;          /* nb of cells of the frame along y */
+            double ox;          /* actual position of the origin of the frame */
+            double oz;
+            bool   mirror_x;    /* true if the frame is mirrored along x around its origin */
+            bool   mirror_z;    /* true if the frame is mirrored along z around its origin */
+        };
+
+        struct Tile {
+            double                   x;          /* actual position of the first corner of the tile */
+            double                   z;
+            int                      step;       /* nb of vertices of the ocean per vertex of the tile */
+            std::vector<Heightfield> surfaces;   /* vertices computed for the tile at the displayed time: the whole tile, or the 4 strips of its border */
+            std::vector<Heightfield> from;       /* the same with the second latest frame */
+            std::vector<Heightfield> to;         /* the same with the latest frame */
+            std::vector<Patch>       patches;    /* parts of the displayed frame drawn inside the border of the tile, if it is not computed */
+        };
+
+        Horizon(Cascade* const, ThreadPool* const, const int, const double, const double, const double, const uint32_t);
+        ~Horizon();
+
+        const std::vector<Tile>& get_tiles() const { return tiles; }
+        const double             get_range() const;
+
+        void update(const Heightfield&, const Heightfield&, const double, const double, const double);
+
+    private:
+
+        typedef Tiling::Transform Transform;
+
+        static const int STEP   = 4;   /* nb of vertices of the ocean per vertex of the far tiles */
+
+        const double    weight(const double, const double, const double, const double) const;
+        const int       tile_step(const double, const double, const double, const double, const bool) const;
+        const int       parts(const bool, const int, int (* const)[4]) const;
+        void patches(const Transform&, Tile* const) const;
+        const double rms(const Heightfield&) const;
+        void sample(const Heightfield&, const Transform&, const int, const int, const float, float* const) const;
+        void fill_part(const Heightfield&, const int, const int, const int, const int* const, const double* const, const double, Heightfield* const) const;
+        float* const vertex(Tile* const, const int, const int) const;
+        void stitch(Tile* const, const Tile&, const bool, const bool);
+
+        const double       lx;              /* actual width of a tile */
+        const double       ly;              /* actual height of a tile */
+        const int          nx;              /* nb of x subdivisions of the ocean */
+        const int          ny;              /* nb of y subdivisions of the ocean */
+        const int          step;            /* STEP, or less for a very small ocean */
+        const int          max_step;        /* step of the coarsest tiles, which have 2 cells at least */
+        const Tiling       tiling;          /* transforms and border blending of the tiles */
+        const int          radius;          /* nb of tiles drawn on each side of the tile of the camera */
+        const double       blend_start;     /* distance to the camera at which the noise starts */
+        const double       blend_end;       /* distance to the camera from which there is only noise */
+        const double       motion_factor;   /* time factor of the waves, as for the ocean */
+        Noise*             noise;           /* waves of the far field */
+        ThreadPool* const  pool;            /* threads computing the tiles, shared with the oceans */
+        std::vector<Tile>  tiles;           /* (2.radius+1)^2 tiles, row after row */
+        double             latest;          /* time of the latest frame the tiles were computed with */
+        int                camera_i;        /* tile of the camera when they were computed */
+        int                camera_j;
+        double             latest_rms;      /* RMS height of that frame */
+
+};
+
+#endif
@@ -21,6 +21,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <ctime>
@@ -31,10 +32,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "cross_platform/GLUT.hpp"
 
 #include "Camera.hpp"
+#include "Horizon.hpp"
 #include "Window.hpp"
 
 namespace Window {
     
+    /* GLUT window */
+    int     mainwindow;
+    
     /* allows to move in the 3D scene */
     Camera* camera;
     
@@ -47,11 +52,13 @@ namespace Window {
     int             t;
     struct timespec tim1, tim2;
 
-    /* Ocean vertices and parameters */
-    int                  nxOcean;
-    int                  nyOcean;
-    std::vector<double*> vertexOceanX;
-    std::vector<double*> vertexOceanY;
+    /* Ocean frames and parameters */
+    Simulation*          simulation;
+    Controller*          controller;       /* live changes of the waves, or nullptr */
+    Horizon*             horizon;          /* tiles of an infinite ocean, or nullptr */
+    Heightfield          previous;         /* second latest frame of the simulation */
+    Heightfield          current;          /* latest frame of the simulation */
+    Heightfield          displayed;        /* interpolation of the two above */
 
     void draw() {
         if(glutGet(GLUT_ELAPSED_TIME) - t >= 1000) fps_action();
@@ -87,23 +94,56 @@ namespace Window {
         glPopMatrix();
     }
     
+    void draw_heightfield(const Heightfield* const frame) {
+        const GLsizei stride = Heightfield::STRIDE*sizeof(float);
+        for(int x = 0 ; x < frame->nx ; x++) {
+            glVertexPointer(3, GL_FLOAT, (frame->nx+1)*stride, &frame->vertices[Heightfield::STRIDE*x]);
+            glDrawArrays(GL_LINE_STRIP, 0, frame->ny+1);
+        }
+        for(int y = 0 ; y < frame->ny ; y++) {
+            glVertexPointer(3, GL_FLOAT, stride, frame->row(y));
+            glDrawArrays(GL_LINE_STRIP, 0, frame->nx+1);
+        }
+    }
+
+    void draw_patch(const Heightfield* const frame, const Horizon::Patch& patch) {
+        const GLsizei stride = Heightfield::STRIDE*sizeof(float);
+        glPushMatrix();
+        glTranslated(patch.ox, 0, patch.oz);
+        glScaled(patch.mirror_x ? -1 : 1, 1, patch.mirror_z ? -1 : 1);
+        for(int x = patch.x ; x <= patch.x + patch.nx ; x++) {
+            glVertexPointer(3, GL_FLOAT, (frame->nx+1)*stride, frame->row(patch.y) + Heightfield::STRIDE*x);
+            glDrawArrays(GL_LINE_STRIP, 0, patch.ny+1);
+        }
+        for(int y = patch.y ; y <= patch.y + patch.ny ; y++) {
+            glVertexPointer(3, GL_FLOAT, stride, frame->row(y) + Heightfield::STRIDE*patch.x);
+            glDrawArrays(GL_LINE_STRIP, 0, patch.nx+1);
+        }
+        glPopMatrix();
+    }
+
     void draw_ocean() {
-        ocean->main_computation();
+        const Heightfield* const latest = simulation->latest();
+        if(latest->time!=current.time) {
+            std::swap(previous, current);
+            current = *latest;
+        }
+        const double shown = simulation->get_time() - 1.0/simulation->get_rate();
         glColor3ub(82, 184, 255);
-        for(int x = 0 ; x < nxOcean ; x++) {
-            ocean->gl_vertex_array_y(x, vertexOceanY[x]);
-            glEnableClientState(GL_VERTEX_ARRAY);
-            glVertexPointer(3, GL_DOUBLE, 0, vertexOceanY[x]);
-            glDrawArrays(GL_LINE_STRIP, 0, nyOcean+1);
-            glDisableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        displayed.interpolate(previous, current, shown);
+        if(horizon) {
+            horizon->update(previous, current, shown, camera->getX(), camera->getZ());
+            const std::vector<Horizon::Tile>& tiles = horizon->get_tiles();
+            for(std::size_t i = 0 ; i < tiles.size() ; i++) {
+                for(std::size_t j = 0 ; j < tiles[i].surfaces.size() ; j++) draw_heightfield(&tiles[i].surfaces[j]);
+                for(std::size_t j = 0 ; j < tiles[i].patches.size() ; j++) draw_patch(&displayed, tiles[i].patches[j]);
+            }
         }
-        for(int y = 0 ; y < nyOcean ; y++) {
-            ocean->gl_vertex_array_x(y, vertexOceanX[y]);
-            glEnableClientState(GL_VERTEX_ARRAY);
-            glVertexPointer(3, GL_DOUBLE, 0, vertexOceanX[y]);
-            glDrawArrays(GL_LINE_STRIP, 0, nxOcean+1);
-            glDisableClientState(GL_VERTEX_ARRAY);
+        else {
+            draw_heightfield(&displayed);
         }
+        glDisableClientState(GL_VERTEX_ARRAY);
         glColor3ub(0, 0, 0);
     }
     
@@ -130,6 +170,7 @@ namespace Window {
     }
     
     void keyboard(unsigned char key, int x, int y) {
+        if(controller && controller->key(key)) return;
         camera->setKeyboard(key, true);
     }
     
@@ -137,17 +178,14 @@ namespace Window {
         camera->setKeyboard(key, false);
     }
 
-    void launch() {
+    void launch(Simulation* const p_simulation, Controller* const p_controller, Horizon* const p_horizon) {
         tim1.tv_sec  = 0;
         tim1.tv_nsec = 0;
         t = glutGet(GLUT_ELAPSED_TIME);
-        nxOcean = ocean->get_nx();
-        nyOcean = ocean->get_ny();
-        for(int i=0 ; i<nyOcean ; i++) vertexOceanX.push_back(new double[3*(nxOcean+1)]);
-        for(int i=0 ; i<nxOcean ; i++) vertexOceanY.push_back(new double[3*(nyOcean+1)]);
-        /* init ocean */
-        for(int x=0 ; x<nxOcean ; x++) ocean->init_gl_vertex_array_y(x, vertexOceanY[x]);
-        for(int y=0 ; y<nyOcean ; y++) ocean->init_gl_vertex_array_x(y, vertexOceanX[y]);
+        simulation = p_simulation;
+        controller = p_controller;
+        horizon    = p_horizon;
+        simulation->start();
         glClearColor(1, 1, 1, 1);
         glutReshapeFunc(reshape);
         glutDisplayFunc(draw);
@@ -167,15 +205,17 @@ namespace Window {
     }
     
     void quit() {
-        for(int i=0 ; i<nyOcean ; i++) delete[] vertexOceanX[i];
-        for(int i=0 ; i<nxOcean ; i++) delete[] vertexOceanY[i];
+        simulation->stop();
+        delete camera;
     }
 
     void reshape(int width, int height) {
         glViewport(0, 0, width, height);
         glMatrixMode(GL_PROJECTION);
         glLoadIdentity();
-        gluPerspective(45, float(width)/float(height), 1, 10*sqrt(pow(ocean->get_ly(), 2) + pow(ocean->get_lx(), 2)));
+        Cascade* const ocean = simulation->get_ocean();
+        const double   range = 10*sqrt(pow(ocean->get_ly(), 2) + pow(ocean->get_lx(), 2));
+        gluPerspective(45, float(width)/float(height), 1, horizon ? std::max(range, horizon->get_range()) : range);
     }
     
 }
@@ -23,7 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /*
 This namespace deals with the rendering of the application. It receives the
-events (mouse, keyboard) and prints the ocean, fps to screen.
+events (mouse, keyboard) and prints the ocean, fps to screen. The ocean is
+computed by a simulation thread, and each drawing uses its latest frame.
+The ocean drawn is the one of the simulation given to launch(), repeated around
+the camera and blended with noise in the distance when a horizon is given too.
 */
 
 #ifndef WINDOWHPP
@@ -32,15 +35,17 @@ events (mouse, keyboard) and prints the ocean, fps to screen.
 #define WIDTH  640
 #define HEIGHT 480
 
-#include "ocean/Ocean.hpp"
-
-extern Ocean* ocean;
-extern int    mainwindow;
+#include "ocean/Cascade.hpp"
+#include "ocean/Controller.hpp"
+#include "ocean/Simulation.hpp"
+#include "Horizon.hpp"
 
 namespace Window {
 
     void draw();                                                                    /* main drawing function, calls the above ones */
     void draw_fps();                                                                /* draws the FPS (Frames Per Second) in the top right corner */
+    void draw_heightfield(const Heightfield* const);                                /* draws the lines of a frame or a tile */
+    void draw_patch(const Heightfield* const, const Horizon::Patch&);               /* draws the lines of a part of a frame, moved and mirrored */
     void draw_ocean();                                                              /* draws the ocean, don't forget to call that one... */
     
     void setFPS(int);                                                               /* sets the target FPS */
@@ -48,11 +53,11 @@ namespace Window {
     void init(int, int, std::string, int, char**, std::string keyboard,
                   int FPS, float translation_speed);                                /* creates the window */
     
-    void keyboard(unsigned char, int, int);                                         /* keyboard (key is pushed) event function */
+    void keyboard(unsigned char, int, int);                                         /* keyboard (key is pushed) event function, the controller keys first */
     void keyboardUp(unsigned char, int, int);                                       /* keyboard (key is released) event function */
     void mouseMove(int, int);                                                       /* mouse event function */
 
-    void launch();                                                                  /* listen to events, initializes the variables and start the drawing */
+    void launch(Simulation* const, Controller* const, Horizon* const);              /* listen to events, initializes the variables and start the drawing */
     void quit();                                                                    /* clean exit - actually never executed */
     void reshape(int, int);                                                         /* sets the viewport and perspective */
 
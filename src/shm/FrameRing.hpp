@@ -0,0 +1,73 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This file describes the shared memory in which the simulation publishes its frames for
+other processes. The memory starts with a header page, followed by NB_SLOTS slots, each
+of them starting on a page boundary with a slot header followed by the planes of floats
+of one frame (see Heightfield::pack). The n-th frame is written in the slot n%NB_SLOTS.
+Each slot is protected by a sequence lock: its sequence is odd while the frame is written,
+and even once it is complete. A reader reads the sequence, the frame, then the sequence
+again: the frame is consistent if both are equal and even. The publisher never waits for
+the readers, which never write to the memory, so that any number of them can read the
+frames where they are, without any copy or lock.
+*/
+
+#ifndef FRAMERINGHPP
+#define FRAMERINGHPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace FrameRing {
+
+    const char     MAGIC[8] = {'F', 'F', 'T', 'R', 'I', 'N', 'G', 0};   /* first bytes of the memory */
+    const uint32_t VERSION  = 1;                                         /* version of the layout */
+    const uint32_t NB_SLOTS = 4;                                         /* nb of frames kept */
+
+    struct header {
+        char                  magic[8];    /* MAGIC */
+        uint32_t              version;     /* VERSION */
+        uint32_t              nb_slots;    /* nb of slots */
+        uint32_t              nx;          /* nb of x subdivisions, the frames have nx+1 columns */
+        uint32_t              ny;          /* nb of y subdivisions, the frames have ny+1 rows */
+        uint32_t              channels;    /* planes of the frames, see Heightfield::CHANNEL */
+        uint32_t              nb_floats;   /* nb of floats per vertex */
+        uint64_t              slot_size;   /* size of a slot with its header, in bytes */
+        uint64_t              data_offset; /* offset of the first slot, in bytes */
+        double                lx;          /* actual width of the ocean */
+        double                ly;          /* actual height of the ocean */
+        std::atomic<uint64_t> published;   /* nb of frames published so far */
+        std::atomic<uint32_t> alive;       /* 1 while the publisher runs */
+    };
+
+    struct slot {
+        std::atomic<uint64_t> sequence;    /* odd while the frame is written */
+        uint64_t              frame;       /* nb of the frame */
+        double                time;        /* simulation time of the frame, in seconds */
+        uint64_t              padding;     /* aligns the floats on 32 bytes */
+    };
+
+}
+
+#endif
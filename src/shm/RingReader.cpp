@@ -0,0 +1,127 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RingReader.hpp"
+
+/*
+Initializes the variables. Nothing can be read before open() is called.
+*/
+RingReader::RingReader() :
+    mapping(nullptr),
+    mapping_size(0),
+    head(nullptr) {
+}
+
+/*
+Unmaps the shared memory if any.
+*/
+RingReader::~RingReader() {
+    if(mapping) munmap(const_cast<void*>(mapping), mapping_size);
+}
+
+/*
+Maps the shared memory of the given name, read only. Throws if it does not
+exist, or was not created by a publisher with the same layout.
+*/
+void RingReader::open(const std::string& name) {
+    const int   fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat st;
+    if(fd<0 || fstat(fd, &st)!=0 || static_cast<std::size_t>(st.st_size)<sizeof(FrameRing::header)) {
+        if(fd>=0) close(fd);
+        throw std::runtime_error("cannot open the shared memory " + name);
+    }
+    void* const m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(m==MAP_FAILED) throw std::runtime_error("cannot map the shared memory " + name);
+    const FrameRing::header* const h = static_cast<const FrameRing::header*>(m);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(memcmp(h->magic, FrameRing::MAGIC, sizeof(h->magic))!=0 || h->version!=FrameRing::VERSION || h->data_offset + h->nb_slots*h->slot_size>static_cast<uint64_t>(st.st_size)) {
+        munmap(m, st.st_size);
+        throw std::runtime_error("the shared memory " + name + " is not a frame ring");
+    }
+    if(mapping) munmap(const_cast<void*>(mapping), mapping_size);
+    mapping      = m;
+    mapping_size = st.st_size;
+    head         = h;
+}
+
+/*
+Returns the header of the given slot.
+*/
+const FrameRing::slot* RingReader::get_slot(const int i) const {
+    return reinterpret_cast<const FrameRing::slot*>(static_cast<const char*>(mapping) + head->data_offset + i*head->slot_size);
+}
+
+/*
+Gives the latest published frame, in place. Returns false if there is no frame
+yet, or if the slot is being written again. The frame must be checked with
+valid() once it has been used.
+*/
+const bool RingReader::latest(view* const v) const {
+    const uint64_t published = get_published();
+    if(published==0) return false;
+    const int                    i = static_cast<int>((published-1)%head->nb_slots);
+    const FrameRing::slot* const s = get_slot(i);
+    v->sequence = s->sequence.load(std::memory_order_acquire);
+    v->frame    = s->frame;
+    v->time     = s->time;
+    v->slot     = i;
+    v->data     = reinterpret_cast<const float*>(reinterpret_cast<const char*>(s) + sizeof(FrameRing::slot));
+    return (v->sequence & 1)==0 && valid(*v);
+}
+
+/*
+Returns true if the frame given by latest() was not overwritten since.
+*/
+const bool RingReader::valid(const view& v) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return get_slot(v.slot)->sequence.load(std::memory_order_relaxed)==v.sequence;
+}
+
+/*
+Copies the latest consistent frame, and gives its time and its number.
+Returns false if there is no frame yet, or if it was always overwritten
+while being copied.
+*/
+const bool RingReader::copy_latest(std::vector<float>* const out, double* const time, uint64_t* const frame) const {
+    view v;
+    out->resize(get_frame_size());
+    for(int i=0 ; i<MAX_TRIES ; i++) {
+        if(!latest(&v)) continue;
+        std::copy(v.data, v.data + out->size(), out->begin());
+        if(valid(v)) {
+            *time  = v.time;
+            *frame = v.frame;
+            return true;
+        }
+    }
+    return false;
+}
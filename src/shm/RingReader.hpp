@@ -0,0 +1,85 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This class reads the frames published by another process in a shared memory (see
+FrameRing). latest() gives the latest frame where it is, without any copy, and valid()
+tells afterwards whether it was overwritten while it was read. The publisher keeps
+NB_SLOTS frames, so a reader has NB_SLOTS-1 frame periods to use a frame. copy_latest()
+copies the latest consistent frame instead, trying again if it was overwritten.
+This class only needs FrameRing.hpp, so that it can be used by other programs.
+*/
+
+#ifndef RINGREADERHPP
+#define RINGREADERHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameRing.hpp"
+
+class RingReader {
+
+    public:
+
+        struct view {
+            const float* data;       /* planes of floats of the frame, see Heightfield::pack */
+            uint64_t     frame;      /* nb of the frame */
+            double       time;       /* simulation time of the frame, in seconds */
+            uint64_t     sequence;   /* sequence of the slot when the frame was taken */
+            int          slot;       /* slot of the frame */
+        };
+
+        RingReader();
+        ~RingReader();
+
+        const int         get_nx()        const { return head->nx; }
+        const int         get_ny()        const { return head->ny; }
+        const int         get_channels()  const { return head->channels; }
+        const int         get_nb_floats() const { return head->nb_floats; }
+        const double      get_lx()        const { return head->lx; }
+        const double      get_ly()        const { return head->ly; }
+        const std::size_t get_frame_size() const { return static_cast<std::size_t>(head->nb_floats)*(head->nx+1)*(head->ny+1); }
+        const uint64_t    get_published() const { return head->published.load(std::memory_order_acquire); }
+        const bool        is_alive()      const { return head->alive.load(std::memory_order_acquire)!=0; }
+
+        void       open(const std::string&);
+        const bool latest(view* const) const;
+        const bool valid(const view&) const;
+        const bool copy_latest(std::vector<float>* const, double* const, uint64_t* const) const;
+
+    private:
+
+        static const int MAX_TRIES = 16;   /* nb of tries of copy_latest() */
+
+        const FrameRing::slot* get_slot(const int) const;
+
+        const void*              mapping;        /* the shared memory, or nullptr */
+        std::size_t              mapping_size;   /* size of the shared memory */
+        const FrameRing::header* head;           /* header of the shared memory */
+
+};
+
+#endif
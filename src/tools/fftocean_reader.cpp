@@ -0,0 +1,88 @@
+/*
+FFTOcean - Copyright (C) 2016 - Olivier Deiss - olivier.deiss@gmail.com
+
+FFTOcean is a C++ implementation of researcher J. Tessendorf's paper
+"Simulating Ocean Water". It is a real-time simulation of ocean water
+in a 3D world. The (reverse) FFT is used to compute the 2D wave height
+field from the Philipps spectrum. It is possible to adjust parameters
+such as wind speed, direction and strength, wave choppiness, and sea depth.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Test reader of the frames published with "fftocean --publish <name>". It waits for
+the shared memory, then prints the number, the time, the mean and the RMS of the
+heights of every frame it sees, read in place. At the end, it prints how many frames
+were read, skipped because the reader was too slow, or overwritten while being read.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "shm/RingReader.hpp"
+
+int main(int argc, char** argv) {
+    if(argc<2) {
+        std::cerr << "usage: fftocean_reader <name> [nb of frames]" << std::endl;
+        return 1;
+    }
+    const int  nb_frames = argc>2 ? atoi(argv[2]) : 100;
+    RingReader reader;
+    for(int i=0 ; ; i++) {
+        try {
+            reader.open(argv[1]);
+            break;
+        }
+        catch(const std::exception& e) {
+            if(i==500) {
+                std::cerr << "error :" << std::endl << "   " << e.what() << std::endl;
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    std::cout << "# " << reader.get_nx() << "x" << reader.get_ny() << ", " << reader.get_nb_floats() << " floats per vertex" << std::endl;
+    const std::size_t nb   = static_cast<std::size_t>(reader.get_nx()+1)*(reader.get_ny()+1);
+    long              read = 0;
+    long              skip = 0;
+    long              torn = 0;
+    uint64_t          last = 0;
+    while(read<nb_frames && (reader.is_alive() || reader.get_published()>(read>0 ? last+1 : 0))) {
+        RingReader::view v;
+        if(!reader.latest(&v) || (read>0 && v.frame<=last)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        double sum  = 0;
+        double sum2 = 0;
+        for(std::size_t i=0 ; i<nb ; i++) {
+            sum  += v.data[i];
+            sum2 += v.data[i]*v.data[i];
+        }
+        if(!reader.valid(v)) {
+            torn++;
+            continue;
+        }
+        if(read>0) skip += static_cast<long>(v.frame - last - 1);
+        last = v.frame;
+        read++;
+        std::cout << v.frame << " " << v.time << " " << sum/nb << " " << sqrt(sum2/nb) << std::endl;
+    }
+    std::cout << "# " << read << " frames read, " << skip << " skipped, " << torn << " overwritten while read" << std::endl;
+    return 0;
+}